@@ -1,5 +1,6 @@
 #pragma once
 #include "appStates/appState.hpp"
+#include "scheduler.hpp"
 #include <functional>
 #include <switch.h>
 #include <thread>
@@ -15,6 +16,8 @@ class ThreadState : public AppState
         {
             // Block home menu
             appletBeginBlockingHomeButton(0);
+            // Slow the UI down and give the copy threads the cores.
+            scheduler::setDumpActive(true);
             // Spawn thread.
             m_thread = std::thread(function, &m_isRunning);
         }
@@ -23,6 +26,7 @@ class ThreadState : public AppState
         {
             // End thread.
             m_thread.join();
+            scheduler::setDumpActive(false);
             appletEndBlockingHomeButton();
         }
 
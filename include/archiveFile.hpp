@@ -0,0 +1,29 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// The file ZipWriter and TarWriter write to. Both only ever append, so this just creates the file at the size the archive is expected to
+// be, writes straight through, and trims off whatever wasn't used when it's closed.
+class ArchiveFile
+{
+    public:
+        // kind is what the archive is called in log messages.
+        ArchiveFile(const char *kind);
+
+        // Replaces whatever's at path with a file allocated at reserveSize.
+        bool open(const char *path, int64_t reserveSize);
+        // Writes data at the current offset.
+        bool write(const void *data, size_t dataSize);
+        // Trims the file to what was written and closes it.
+        bool close(void);
+
+        bool isOpen(void) const;
+        // Returns how many bytes have been written so far.
+        int64_t getOffset(void) const;
+
+    private:
+        fslib::File m_file;
+        const char *m_kind = nullptr;
+        int64_t m_offset = 0;
+};
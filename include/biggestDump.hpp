@@ -1,5 +1,6 @@
 #pragma once
 #include "appStates/appState.hpp"
+#include "sdl.hpp"
 #include <memory>
 #include <vector>
 
@@ -26,4 +27,6 @@ class BiggestDump
         static inline bool sm_isRunning = false;
         // State vector
         static inline std::vector<std::shared_ptr<AppState>> sm_stateVector;
+        // Title and lines. These never change, so they're rendered once.
+        static inline sdl::SharedTexture sm_chromeTexture;
 };
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+
+// Every transfer buffer biggestDump uses comes out of here. The whole pool is allocated once at startup, page aligned, and handed out
+// and taken back by every dump after that, so starting a dump or a split volume never has to go looking for megabytes of heap. The pool
+// is carved into buffers of whatever size the dump wants, so a small slot size means more buffers instead of wasted memory.
+namespace bufferPool
+{
+    // Largest buffer the pool can be carved into. Same as the largest slot size ioTuner tries. This is what it starts out as.
+    static constexpr size_t MAX_BUFFER_SIZE = 0x200000;
+    // Buffers are aligned to this so fs can map them straight through instead of bouncing the edges. It's also the smallest buffer.
+    static constexpr size_t BUFFER_ALIGNMENT = 0x1000;
+    // The pool always has at least this many buffers, no matter how big they are.
+    static constexpr size_t MIN_BUFFER_COUNT = 4;
+
+    // Picks the budget from how much memory the process has to work with and allocates the pool. Returns false if it couldn't.
+    bool initialize(void);
+    // Frees the pool. Everything acquired has to be released first.
+    void exit(void);
+
+    // Carves the pool into buffers of bufferSize, rounded up to BUFFER_ALIGNMENT and capped at MAX_BUFFER_SIZE. Every buffer has to be
+    // back in the pool. Returns false and leaves it alone if any aren't.
+    bool setBufferSize(size_t bufferSize);
+    // Returns the size of every buffer in the pool right now.
+    size_t getBufferSize(void);
+    // Returns how many buffers are in the pool.
+    size_t getBufferCount(void);
+    // Waits until count buffers are free and writes them to buffersOut. All of them or none. Returns false without waiting if the pool
+    // doesn't have count buffers to begin with.
+    bool acquire(unsigned char **buffersOut, size_t count);
+    // Hands count buffers from buffers back to the pool.
+    void release(unsigned char *const *buffers, size_t count);
+} // namespace bufferPool
@@ -1,7 +1,10 @@
 #pragma once
+#include "mpscQueue.hpp"
 #include "sdl.hpp"
+#include <atomic>
 #include <cstdarg>
 #include <cstddef>
+#include <cstdio>
 #include <cstring>
 #include <string>
 
@@ -22,25 +25,27 @@ class Console
             console.m_y = y;
         }
 
-        // Sets the maximum amount of lines that should be displayed before we start clipping.
-        static void setMaxLineCount(size_t maxLineCount)
+        // Sets the size of the area the console is rendered to. The console's texture is this size.
+        static void setSize(int width, int height)
         {
             Console &console = Console::getInstance();
-            console.m_maxLineCount = maxLineCount;
+            console.m_width = width;
+            console.m_height = height;
         }
 
-        // Sets the size of the font in pixels. Default is 20 pixels.
-        static void setFontSize(int fontSize)
+        // Sets the maximum amount of lines that should be displayed before we start clipping. Can't be more than MAX_LINE_COUNT.
+        static void setMaxLineCount(size_t maxLineCount)
         {
             Console &console = Console::getInstance();
-            console.m_fontSize = fontSize;
+            console.m_maxLineCount = maxLineCount == 0 || maxLineCount > MAX_LINE_COUNT ? MAX_LINE_COUNT : maxLineCount;
         }
 
-        // Sets the size of the buffer used for printf. Default is 0x1000 and that should be plenty.
-        static void setBufferSize(size_t bufferSize)
+        // Sets the size of the font in pixels. Default is 20 pixels.
+        static void setFontSize(int fontSize)
         {
             Console &console = Console::getInstance();
-            console.m_bufferSize = bufferSize;
+            console.m_fontSize = fontSize;
+            console.m_textureIsStale = true;
         }
 
         // Sets the color used to render text.
@@ -48,90 +53,86 @@ class Console
         {
             Console &console = Console::getInstance();
             console.m_renderColor = color;
+            console.m_textureIsStale = true;
         }
 
+        // Formats and queues text for the console. Safe to call from any thread and never waits. If the queue doesn't have room for all of it,
+        // the text is dropped. Waiting for room would never end on the render thread, and only the last lines are on screen anyway.
         static void printf(const char *format, ...)
         {
             Console &console = Console::getInstance();
 
-            // Va
-            char vaBuffer[console.m_bufferSize] = {0};
+            char vaBuffer[VA_BUFFER_SIZE] = {0};
             std::va_list vaList;
             va_start(vaList, format);
-            vsnprintf(vaBuffer, console.m_bufferSize, format, vaList);
+            vsnprintf(vaBuffer, VA_BUFFER_SIZE, format, vaList);
             va_end(vaList);
 
-            // Get count of how many lines are in the string.
-            size_t newLineCount = 0;
-            const char *newLineSearch = vaBuffer;
-            while ((newLineSearch = std::strchr(newLineSearch, '\n')) != NULL)
+            // Most fit in one message. The instructions don't, so they're queued as one run so another thread's printf can't land in the
+            // middle of them.
+            Message messages[MAX_MESSAGES_PER_PRINTF];
+            size_t messageCount = 0;
+            size_t textLength = std::char_traits<char>::length(vaBuffer);
+            for (size_t offset = 0; offset < textLength; offset += MESSAGE_SIZE - 1)
             {
-                ++newLineCount;
-                ++newLineSearch;
+                Message &message = messages[messageCount++];
+                size_t chunkLength = textLength - offset < MESSAGE_SIZE - 1 ? textLength - offset : MESSAGE_SIZE - 1;
+                message.isReset = false;
+                std::memcpy(message.text, &vaBuffer[offset], chunkLength);
+                message.text[chunkLength] = '\0';
             }
 
-            // Check the end of the vaBuffer to see if we need a fake new line
-            size_t vaBufferLength = std::char_traits<char>::length(vaBuffer);
-            if (vaBuffer[vaBufferLength - 1] != '\n')
+            if (console.m_messageQueue.tryPushAll(messages, messageCount))
             {
-                ++newLineCount;
-                console.m_tempLineAdded = true;
+                console.m_isDirty.store(true, std::memory_order_release);
             }
-            else if (vaBuffer[vaBufferLength - 1] == '\n' && console.m_tempLineAdded)
+        }
+
+        // Renders the console to the main framebuffer. The text is only rasterized again when something was printed since the last frame.
+        // Only the main thread should call this.
+        static void render(void)
+        {
+            Console &console = Console::getInstance();
+            if (console.m_isDirty.exchange(false, std::memory_order_acquire))
             {
-                // Account for the fake new line.
-                --newLineCount;
-                console.m_tempLineAdded = false;
+                console.processMessages();
+                console.m_textureIsStale = true;
             }
 
-            // Add new lines to count.
-            console.m_lineCount += newLineCount;
-
-            if (console.m_lineCount >= console.m_maxLineCount)
+            if (!console.m_consoleTexture)
             {
-                // Number of lines to trim from string.
-                size_t trimLines = console.m_lineCount - console.m_maxLineCount;
-
-                for (size_t i = 0, currentLinePosition = 0; i < trimLines; i++)
-                {
-                    // Find position of next line to trim off the top.
-                    currentLinePosition = console.m_consoleString.find_first_of('\n', currentLinePosition) + 1;
-
-                    // Trim it or break the loop if something weird happens.
-                    if (currentLinePosition == console.m_consoleString.npos)
-                    {
-                        break;
-                    }
-                    // Trim the line from the beginning.
-                    console.m_consoleString.erase(0, currentLinePosition);
-                    // Go forward one character in the buffer/string and subtract the lines we trimmed.
-                    ++currentLinePosition;
-                    console.m_lineCount -= trimLines;
-                }
+                console.m_consoleTexture =
+                    sdl::TextureManager::createLoadTexture("ConsoleTexture", console.m_width, console.m_height, SDL_TEXTUREACCESS_TARGET);
             }
-            // Append our va string from earlier.
-            console.m_consoleString += vaBuffer;
-        }
 
-        // Renders the console directly to the main framebuffer target.
-        static void render(void)
-        {
-            Console &console = Console::getInstance();
-            sdl::text::render(NULL,
-                              console.m_x,
-                              console.m_y,
-                              console.m_fontSize,
-                              sdl::text::NO_TEXT_WRAP,
-                              console.m_renderColor,
-                              console.m_consoleString.c_str());
+            if (console.m_textureIsStale)
+            {
+                console.m_consoleTexture->clear({0x00000000});
+                sdl::text::render(console.m_consoleTexture->get(),
+                                  0,
+                                  0,
+                                  console.m_fontSize,
+                                  sdl::text::NO_TEXT_WRAP,
+                                  console.m_renderColor,
+                                  console.m_consoleString.c_str());
+                console.m_textureIsStale = false;
+            }
+            console.m_consoleTexture->render(NULL, console.m_x, console.m_y);
         }
 
-        // Resets and clears the console.
+        // Resets and clears the console. This is queued like everything else so it lands in order with printf, and is dropped the same way
+        // if the queue is full.
         static void reset(void)
         {
             Console &console = Console::getInstance();
-            console.m_lineCount = 0;
-            console.m_consoleString.clear();
+
+            Message message;
+            message.isReset = true;
+            message.text[0] = '\0';
+            if (console.m_messageQueue.tryPush(message))
+            {
+                console.m_isDirty.store(true, std::memory_order_release);
+            }
         }
 
     private:
@@ -143,19 +144,109 @@ class Console
             static Console console;
             return console;
         }
+        // Max length of a single printf. Anything longer is cut off.
+        static constexpr size_t VA_BUFFER_SIZE = 0x1000;
+        // Printfs are split into messages this size. Small so the queue can hold a lot of them between the throttled frames of a dump.
+        static constexpr size_t MESSAGE_SIZE = 0x200;
+        // Most messages a single printf can take.
+        static constexpr size_t MAX_MESSAGES_PER_PRINTF = (VA_BUFFER_SIZE - 1 + MESSAGE_SIZE - 2) / (MESSAGE_SIZE - 1);
+        // Max number of messages waiting on the next frame. Must be a power of two.
+        static constexpr size_t MESSAGE_QUEUE_CAPACITY = 256;
+        static_assert(MAX_MESSAGES_PER_PRINTF <= MESSAGE_QUEUE_CAPACITY, "The longest printf has to fit in the queue.");
+        // Max length of a line on screen and the most lines that can be kept.
+        static constexpr size_t LINE_SIZE = 0x200;
+        static constexpr size_t MAX_LINE_COUNT = 64;
+
+        // A printf or a reset waiting on the render thread.
+        struct Message
+        {
+                bool isReset;
+                char text[MESSAGE_SIZE];
+        };
+
         // X and Y coordinates.
         int m_x = 0, m_y = 0;
+        // Size of the area and texture the console renders to.
+        int m_width = 1280, m_height = 720;
         // Line counts
         size_t m_lineCount = 0;
-        size_t m_maxLineCount = 0;
+        size_t m_maxLineCount = MAX_LINE_COUNT;
         // Font size
         int m_fontSize = 20;
-        // Size of the vaBuffer.
-        size_t m_bufferSize = 0x1000;
         // Color used to render. Default is white.
         sdl::Color m_renderColor = {0xFFFFFFFF};
-        // This bool might just save the day. This controls whether or not the console has a fake new line at the end so printing works semi-right.
-        bool m_tempLineAdded = false;
-        // Console string
+        // Whether the newest line is still waiting on its new line. printf without one keeps adding to the same line.
+        bool m_lineIsOpen = false;
+        // Ring of lines on screen. m_firstLine is the oldest. Only touched by the render thread.
+        char m_lines[MAX_LINE_COUNT][LINE_SIZE];
+        size_t m_lineLengths[MAX_LINE_COUNT] = {0};
+        size_t m_firstLine = 0;
+        // What actually gets rendered. Rebuilt from the lines when something changes.
         std::string m_consoleString;
+        // Everything printf and reset send to the render thread.
+        MpscQueue<Message, MESSAGE_QUEUE_CAPACITY> m_messageQueue;
+        // Set after anything is queued so render knows there's work to do.
+        std::atomic<bool> m_isDirty = false;
+        // The console's text as of the last time it changed. Only rasterized again when m_textureIsStale is set.
+        sdl::SharedTexture m_consoleTexture;
+        bool m_textureIsStale = true;
+
+        // Empties the queue into the lines and rebuilds the string.
+        void processMessages(void)
+        {
+            Message message;
+            while (m_messageQueue.tryPop(message))
+            {
+                if (message.isReset)
+                {
+                    m_lineCount = 0;
+                    m_lineIsOpen = false;
+                    continue;
+                }
+
+                for (const char *text = message.text; *text != '\0'; text++)
+                {
+                    Console::addCharacter(*text);
+                }
+            }
+
+            // Lines end with a new line so they render the same way they did when this was one big string.
+            m_consoleString.clear();
+            for (size_t i = 0; i < m_lineCount; i++)
+            {
+                size_t lineIndex = (m_firstLine + i) % MAX_LINE_COUNT;
+                m_consoleString.append(m_lines[lineIndex], m_lineLengths[lineIndex]);
+                if (i + 1 < m_lineCount || !m_lineIsOpen)
+                {
+                    m_consoleString += '\n';
+                }
+            }
+        }
+
+        // Adds character to the newest line, starting a new one and dropping the oldest if it needs to.
+        void addCharacter(char character)
+        {
+            if (!m_lineIsOpen)
+            {
+                if (m_lineCount == m_maxLineCount)
+                {
+                    m_firstLine = (m_firstLine + 1) % MAX_LINE_COUNT;
+                    --m_lineCount;
+                }
+                m_lineLengths[(m_firstLine + m_lineCount++) % MAX_LINE_COUNT] = 0;
+                m_lineIsOpen = true;
+            }
+
+            if (character == '\n')
+            {
+                m_lineIsOpen = false;
+                return;
+            }
+
+            size_t lineIndex = (m_firstLine + m_lineCount - 1) % MAX_LINE_COUNT;
+            if (m_lineLengths[lineIndex] < LINE_SIZE)
+            {
+                m_lines[lineIndex][m_lineLengths[lineIndex]++] = character;
+            }
+        }
 };
@@ -0,0 +1,109 @@
+#pragma once
+#include "fslib.hpp"
+#include "ncaVerifier.hpp"
+#include "spscQueue.hpp"
+#include "transferSink.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// This is the read, hash, and write threads that do all of the actual copying. It's started once and fed jobs, so the read thread can
+// already be working on the next file while the write thread is still finishing the last one. Every chunk passes through the hash thread
+// on its way to the write thread so NCAs are checked against their names for free.
+class CopyEngine
+{
+    public:
+        // Spawns the read, hash, and write threads. Everything read is passed to sink on the write thread. engineCount is how many engines
+        // are going to run at once so each only borrows its share of bufferPool. engineIndex is which of them this is so its threads land
+        // on different cores than the others'.
+        CopyEngine(TransferSink &sink, size_t engineCount = 1, size_t engineIndex = 0);
+        // Finishes whatever is left and joins the threads.
+        ~CopyEngine();
+
+        // No copying.
+        CopyEngine(const CopyEngine &) = delete;
+        CopyEngine(CopyEngine &&) = delete;
+        CopyEngine &operator=(const CopyEngine &) = delete;
+        CopyEngine &operator=(CopyEngine &&) = delete;
+
+        // Queues source to be copied to destination. Waits if the engine already has enough jobs lined up.
+        void submit(const fslib::Path &source, const fslib::Path &destination);
+        // Tells the engine no more jobs are coming and waits for everything queued to be written.
+        void finish(void);
+
+    private:
+        // Fewest and most slots an engine can have in flight between the threads. The actual size and count come from ioTuner.
+        static constexpr size_t MIN_TRANSFER_SLOT_COUNT = 2;
+        static constexpr size_t MAX_TRANSFER_SLOT_COUNT = 16;
+        // Max number of jobs waiting on the read thread before submit() blocks. Enough to read ahead, small enough that other
+        // pipelines can steal the rest of the work.
+        static constexpr size_t MAX_QUEUED_JOBS = 2;
+
+        // Source and destination of a file to copy.
+        struct CopyJob
+        {
+                fslib::Path source;
+                fslib::Path destination;
+                // Filled in by the read thread once the source is open.
+                int64_t fileSize = 0;
+                // If the read thread couldn't open or read the source, this is why.
+                std::string errorString;
+                // CRC32 and SHA-256 of the file. Filled in by the hash thread after the last chunk.
+                uint32_t crc = 0;
+                uint8_t hash[SHA256_HASH_SIZE] = {0};
+                // Whether the hash was checked against a content ID name and whether it matched.
+                bool wasVerified = false;
+                bool hashMatched = false;
+        };
+
+        // A slot the read thread fills and the write thread writes straight from.
+        struct TransferSlot
+        {
+                // Borrowed from bufferPool for as long as the engine is running.
+                unsigned char *buffer = nullptr;
+                // Job this chunk belongs to. nullptr tells the write thread to exit.
+                std::shared_ptr<CopyJob> job;
+                // Bytes read. Anything below zero means the read failed.
+                ssize_t readSize = 0;
+                // Whether this is the last chunk of the job.
+                bool isLast = false;
+        };
+
+        using SlotQueue = SpscQueue<size_t, MAX_TRANSFER_SLOT_COUNT>;
+
+        // Slots and the queues their indexes travel through. Free -> read thread -> filled -> hash thread -> hashed -> write thread -> free.
+        TransferSlot m_slots[MAX_TRANSFER_SLOT_COUNT];
+        SlotQueue m_freeQueue, m_filledQueue, m_hashedQueue;
+        // Size of each slot's buffer and how many of m_slots are actually used.
+        size_t m_slotSize = 0;
+        size_t m_slotCount = 0;
+
+        // Jobs waiting for the read thread.
+        std::mutex m_jobMutex;
+        std::condition_variable m_jobCondition;
+        // Signaled when the read thread takes a job off the queue.
+        std::condition_variable m_queueCondition;
+        std::deque<std::shared_ptr<CopyJob>> m_jobQueue;
+        // Set by finish() so the read thread knows to stop once the queue is empty.
+        bool m_noMoreJobs = false;
+
+        // Where everything ends up.
+        TransferSink &m_sink;
+        // Passed to scheduler so every engine's threads get their own cores.
+        size_t m_engineIndex = 0;
+
+        // Threads.
+        std::thread m_readThread, m_hashThread, m_writeThread;
+
+        // Thread functions.
+        void readThreadFunction(void);
+        void hashThreadFunction(void);
+        void writeThreadFunction(void);
+        // Pops a slot index from queue. traceName is what the wait shows up as in a trace.
+        size_t popSlot(SlotQueue &queue, const char *traceName);
+        // Passes a slot with no data down the pipeline. Used for empty files, errors, and telling the other threads to exit.
+        void sendEmptySlot(std::shared_ptr<CopyJob> job, ssize_t readSize);
+};
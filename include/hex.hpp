@@ -0,0 +1,23 @@
+#pragma once
+
+// Hex parsing shared by the manifest reader and the NCA verifier.
+namespace hex
+{
+    // Converts a single hex digit. Returns -1 if it isn't one.
+    inline int digitToInt(char digit)
+    {
+        if (digit >= '0' && digit <= '9')
+        {
+            return digit - '0';
+        }
+        else if (digit >= 'a' && digit <= 'f')
+        {
+            return digit - 'a' + 10;
+        }
+        else if (digit >= 'A' && digit <= 'F')
+        {
+            return digit - 'A' + 10;
+        }
+        return -1;
+    }
+} // namespace hex
@@ -1,4 +1,19 @@
 #pragma once
 #include "fslib.hpp"
+#include "manifest.hpp"
+#include "manifestFile.hpp"
 
-void copyDirectory(const fslib::Path &source, const fslib::Path &destination);
+// Copies everything in manifest from source to destination, largest files first. pipelineCount is the number of files that can be
+// copied at once. Anything above one spreads the files across that many read/write pipelines with work stealing. Files that are copied
+// successfully are recorded to manifestFile if it isn't nullptr.
+void copyManifest(const Manifest &manifest,
+                  const fslib::Path &source,
+                  const fslib::Path &destination,
+                  size_t pipelineCount = 1,
+                  ManifestFile *manifestFile = nullptr);
+
+// Gets the amount of free space on the SD card. Returns false on failure.
+bool getSdmcFreeSpace(int64_t &freeSpaceOut);
+
+// Gets the total size of the SD card. Returns false on failure.
+bool getSdmcTotalSpace(int64_t &totalSpaceOut);
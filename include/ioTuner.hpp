@@ -0,0 +1,21 @@
+#pragma once
+#include "fslib.hpp"
+#include "manifest.hpp"
+#include <cstddef>
+
+// Picks the size and number of transfer slots CopyEngine uses. Which is fastest depends on the SD card, so this times reads from the
+// actual source and writes to the actual SD and saves what it found for next time.
+namespace ioTuner
+{
+    // Loads the result saved at cachePath. Returns false if there isn't one or it was measured with a different SD card.
+    bool load(const char *cachePath);
+    // Runs the read probes against the largest files in manifest under source and the write probes with a scratch file at probePath.
+    void tune(const Manifest &manifest, const fslib::Path &source, const char *probePath);
+    // Saves the current result to cachePath. Returns false on failure.
+    bool save(const char *cachePath);
+
+    // Returns the size of each transfer slot.
+    size_t getSlotSize(void);
+    // Returns the number of transfer slots.
+    size_t getSlotCount(void);
+} // namespace ioTuner
@@ -1,7 +1,42 @@
 #pragma once
 
+// Lines are formatted on the calling thread, dropped into a ring and written to the log in batches by a thread of their own. Nothing that
+// logs ever waits on the SD.
 namespace logger
 {
+    // How bad a line is. Lines below BIGGESTDUMP_LOG_LEVEL are never compiled in.
+    enum Level
+    {
+        LEVEL_DEBUG,
+        LEVEL_INFO,
+        LEVEL_WARNING,
+        LEVEL_ERROR
+    };
+
+    // Creates a blank log and starts the thread that writes to it.
     void initialize(void);
-    void log(const char *Format, ...);
+    // Writes whatever is left and stops the thread. Nothing logged after this makes it to the log.
+    void exit(void);
+    // Writes whatever is waiting right now on the calling thread.
+    void flush(void);
+    // Formats and queues a line. Use the LOG_ macros instead so lines below the build's level cost nothing.
+    void log(logger::Level level, const char *format, ...) __attribute__((format(printf, 2, 3)));
 } // namespace logger
+
+// make LOG_LEVEL=0 for everything. Default is info and up.
+#ifndef BIGGESTDUMP_LOG_LEVEL
+#define BIGGESTDUMP_LOG_LEVEL 1
+#endif
+
+#define LOG_AT(level, ...)                                                                                                                 \
+    do                                                                                                                                     \
+    {                                                                                                                                      \
+        if constexpr (level >= BIGGESTDUMP_LOG_LEVEL)                                                                                      \
+        {                                                                                                                                  \
+            logger::log(level, __VA_ARGS__);                                                                                               \
+        }                                                                                                                                  \
+    } while (false)
+#define LOG_DEBUG(...) LOG_AT(logger::LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(logger::LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(logger::LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(logger::LEVEL_ERROR, __VA_ARGS__)
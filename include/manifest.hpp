@@ -0,0 +1,46 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// A file or directory found while scanning.
+struct ManifestEntry
+{
+        // Path relative to the root that was scanned.
+        std::string path;
+        // Size in bytes. Always zero for directories.
+        int64_t size = 0;
+        bool isDirectory = false;
+};
+
+// In-memory list of everything under a directory so dumps know what they're in for before they start.
+class Manifest
+{
+    public:
+        Manifest(void) = default;
+
+        // Walks root and records every file and directory under it. Returns false if root couldn't be opened.
+        bool scan(const fslib::Path &root);
+
+        // Returns every entry in the order they were found. Directories always come before what's in them.
+        const std::vector<ManifestEntry> &getEntries(void) const;
+        // Returns pointers to just the files, sorted largest first so the big ones don't end up as a long tail.
+        std::vector<const ManifestEntry *> getFilesLargestFirst(void) const;
+
+        // Removes every file predicate returns true for and updates the totals. Directories are left alone. Returns the number removed.
+        size_t removeFiles(const std::function<bool(const ManifestEntry &)> &predicate);
+        // Removes every directory that doesn't have a file somewhere under it anymore. Returns the number removed.
+        size_t removeEmptyDirectories(void);
+
+        // Returns the combined size of every file.
+        int64_t getTotalSize(void) const;
+        // Returns how many files were found.
+        size_t getFileCount(void) const;
+
+    private:
+        std::vector<ManifestEntry> m_entries;
+        int64_t m_totalSize = 0;
+        size_t m_fileCount = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <switch.h>
+#include <unordered_map>
+
+// A file that made it to the SD in one piece.
+struct ManifestFileEntry
+{
+        int64_t size = 0;
+        uint8_t hash[SHA256_HASH_SIZE] = {0};
+};
+
+// This is the manifest written next to a dump as files finish. It's one line per file: size, SHA-256, and path relative to the dump's
+// root. Since lines are only written once a file is complete, anything missing from it after an interrupted dump needs to be copied again.
+class ManifestFile
+{
+    public:
+        ManifestFile(void) = default;
+
+        // Loads the manifest at path. Returns false if it doesn't exist or couldn't be read.
+        bool load(const fslib::Path &path);
+        // Returns the entry for path or nullptr if there isn't one.
+        const ManifestFileEntry *find(const std::string &path) const;
+        // Returns the number of entries loaded or added.
+        size_t getCount(void) const;
+        // Returns every entry by relative path. Not safe while files are still being added.
+        const std::unordered_map<std::string, ManifestFileEntry> &getEntries(void) const;
+
+        // Starts a new manifest at path, replacing what was there. Entries that were loaded are written back out first so nothing is lost
+        // if this run gets interrupted too. root is the dump's root directory so destination paths can be trimmed.
+        bool create(const fslib::Path &path, const fslib::Path &root);
+        // Removes the entry for path so it isn't written back out by create().
+        void remove(const std::string &path);
+        // Records a finished file. This is called from the write threads, so it locks.
+        void addFile(const fslib::Path &destination, int64_t size, const uint8_t *hash);
+
+    private:
+        // Entries by relative path.
+        std::unordered_map<std::string, ManifestFileEntry> m_entries;
+        // Root dump paths are relative to.
+        std::string m_root;
+        // File being written to.
+        std::unique_ptr<fslib::File> m_file;
+        std::mutex m_fileMutex;
+
+        // Writes a single line to m_file.
+        void writeEntry(const std::string &path, const ManifestFileEntry &entry);
+};
@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Lock-free multiple producer, single consumer queue. Any thread can push, exactly one thread can pop. Nothing ever waits for room, so the
+// consumer can push to its own queue without deadlocking.
+// CAPACITY must be a power of two.
+template <typename T, size_t CAPACITY>
+class MpscQueue
+{
+    public:
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "MpscQueue capacity must be a power of two.");
+
+        MpscQueue(void)
+        {
+            for (size_t i = 0; i < CAPACITY; i++)
+            {
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        // No copying.
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue(MpscQueue &&) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+        MpscQueue &operator=(MpscQueue &&) = delete;
+
+        // Tries to push value to the queue. Returns false if the queue is full.
+        bool tryPush(const T &value)
+        {
+            return MpscQueue::tryPushAll(&value, 1);
+        }
+
+        // Tries to push all count values as one run. Nothing another producer pushes can land between them. Returns false and pushes
+        // nothing if there isn't room for all of them.
+        bool tryPushAll(const T *values, size_t count)
+        {
+            if (count == 0 || count > CAPACITY)
+            {
+                return count == 0;
+            }
+
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            while (true)
+            {
+                // The consumer frees cells in order, so if the last one is free everything before it is too.
+                size_t lastPosition = tail + count - 1;
+                size_t firstSequence = m_cells[tail & (CAPACITY - 1)].sequence.load(std::memory_order_acquire);
+                size_t lastSequence = m_cells[lastPosition & (CAPACITY - 1)].sequence.load(std::memory_order_acquire);
+                if (firstSequence == tail && lastSequence == lastPosition)
+                {
+                    // Whoever wins this owns the cells until they bump their sequences.
+                    if (m_tail.compare_exchange_weak(tail, tail + count, std::memory_order_relaxed))
+                    {
+                        for (size_t i = 0; i < count; i++)
+                        {
+                            Cell &cell = m_cells[(tail + i) & (CAPACITY - 1)];
+                            cell.value = values[i];
+                            cell.sequence.store(tail + i + 1, std::memory_order_release);
+                        }
+                        return true;
+                    }
+                }
+                else if (firstSequence < tail || lastSequence < lastPosition)
+                {
+                    // The consumer hasn't gotten to these yet.
+                    return false;
+                }
+                else
+                {
+                    // Another producer got there first.
+                    tail = m_tail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Tries to pop the front of the queue to valueOut. Returns false if the queue is empty or the producer at the front isn't done yet.
+        bool tryPop(T &valueOut)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            Cell &cell = m_cells[head & (CAPACITY - 1)];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+            {
+                return false;
+            }
+            valueOut = cell.value;
+            // Hand the cell back for the next time around.
+            cell.sequence.store(head + CAPACITY, std::memory_order_release);
+            m_head.store(head + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+    private:
+        // sequence equals the cell's position while it's free and position + 1 once it holds a value.
+        struct Cell
+        {
+                std::atomic<size_t> sequence;
+                T value;
+        };
+
+        // Head is only written by the consumer, tail by every producer. Separate cache lines so they don't fight.
+        alignas(64) std::atomic<size_t> m_head = 0;
+        alignas(64) std::atomic<size_t> m_tail = 0;
+        // The actual queue.
+        Cell m_cells[CAPACITY];
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <switch.h>
+
+// NCAs are named after the first half of their SHA-256. This hashes one as it's copied so it can be checked against its name at the end
+// without reading it again. libnx's SHA-256 uses the ARMv8 crypto extensions, so this is cheap next to the actual I/O.
+class NcaVerifier
+{
+    public:
+        NcaVerifier(void) = default;
+
+        // Returns whether the file at path is named like a content ID (32 hex digits + .nca or .cnmt.nca) and can be checked. Split NCAs
+        // are stored as a directory of numbered parts, so those don't count.
+        static bool isVerifiable(const char *path);
+
+        // Starts hashing a new file.
+        void begin(void);
+        // Adds data to the hash.
+        void update(const void *data, size_t dataSize);
+        // Finishes the hash and compares it to the content ID in path's name. Returns true if it matches.
+        bool finish(const char *path);
+
+        // Returns the full hash after finish().
+        const uint8_t *getHash(void) const;
+
+    private:
+        Sha256Context m_context;
+        uint8_t m_hash[SHA256_HASH_SIZE] = {0};
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+// pigz-style deflate. Input is split into independent blocks that are compressed on every core at once. Each block is primed with the
+// 32KB before it as a dictionary and ends on a byte boundary, so the blocks glued back together in order are one valid raw deflate stream.
+class ParallelDeflate
+{
+    public:
+        // Function compressed output is passed to in order. Returning false stops compression.
+        using OutputFunction = std::function<bool(const unsigned char *, size_t)>;
+
+        // Spawns threadCount workers that compress at level and a thread that passes their output on. If none of the workers can start,
+        // everything is compressed on the calling thread instead.
+        ParallelDeflate(int level, size_t threadCount);
+        // Stops and joins the workers.
+        ~ParallelDeflate();
+
+        // No copying.
+        ParallelDeflate(const ParallelDeflate &) = delete;
+        ParallelDeflate(ParallelDeflate &&) = delete;
+        ParallelDeflate &operator=(const ParallelDeflate &) = delete;
+        ParallelDeflate &operator=(ParallelDeflate &&) = delete;
+
+        // Starts a new stream whose output is passed to outputFunction.
+        void begin(const OutputFunction &outputFunction);
+        // Queues data to be compressed. data is copied, so it can be reused as soon as this returns. This only waits if too much is already
+        // queued. isLast ends the stream and waits for all of it to be output. Returns false if compression or output failed.
+        bool compress(const unsigned char *data, size_t dataSize, bool isLast);
+
+        // Returns the CRC32 of everything passed to compress() since begin(). Only complete once compress() was called with isLast.
+        uint32_t getCrc(void) const;
+        // Returns the uncompressed and compressed sizes of the stream since begin(). Same as above.
+        uint64_t getUncompressedSize(void) const;
+        uint64_t getCompressedSize(void) const;
+
+    private:
+        // Size of the blocks input is split into. Same as pigz.
+        static constexpr size_t BLOCK_SIZE = 0x20000;
+        // Deflate's window. This much of what came before a block is used as its dictionary.
+        static constexpr size_t DICTIONARY_SIZE = 0x8000;
+        // Most blocks that can be waiting to be compressed or output at once. Enough to keep every worker busy while the output thread
+        // waits on the SD, without holding on to too much memory.
+        static constexpr size_t MAX_PENDING_BLOCKS = 16;
+
+        // A single block handed to a worker.
+        struct DeflateBlock
+        {
+                // The dictionary followed by the input, copied so compress() doesn't have to wait for it.
+                std::vector<unsigned char> data;
+                size_t dictionarySize = 0;
+                // Last block of the stream gets Z_FINISH instead of Z_SYNC_FLUSH.
+                bool isLast = false;
+                // Output and the CRC of the input. Only the block's worker touches these until isFinished is set.
+                std::vector<unsigned char> output;
+                uint32_t crc = 0;
+                bool failed = false;
+                bool isFinished = false;
+        };
+
+        // Compression level.
+        int m_level = Z_DEFAULT_COMPRESSION;
+
+        // Blocks waiting to be compressed or output, in stream order. m_nextBlock is the first one no worker has taken yet. Blocks that
+        // were output are kept in m_spareBlocks so their buffers can be reused.
+        std::deque<std::unique_ptr<DeflateBlock>> m_blocks;
+        size_t m_nextBlock = 0;
+        std::vector<std::unique_ptr<DeflateBlock>> m_spareBlocks;
+        // Workers that started and workers that couldn't initialize deflate.
+        size_t m_startedWorkers = 0;
+        size_t m_failedWorkers = 0;
+        bool m_exitThreads = false;
+        // Set once output fails. Everything left in the stream is dropped.
+        bool m_outputFailed = false;
+        std::mutex m_blockMutex;
+        // Workers wait on m_workCondition for new blocks. Everything else waits on m_doneCondition for blocks to be finished or output.
+        std::condition_variable m_workCondition, m_doneCondition;
+
+        // Last DICTIONARY_SIZE bytes passed to compress() so the next block has something to prime with.
+        std::unique_ptr<unsigned char[]> m_dictionary;
+        size_t m_dictionarySize = 0;
+
+        // Where the stream goes.
+        OutputFunction m_outputFunction;
+
+        // Stream totals. Only the output thread updates these while a stream is running.
+        uint32_t m_crc = 0;
+        uint64_t m_uncompressedSize = 0, m_compressedSize = 0;
+
+        // Used on the calling thread when no workers could start.
+        z_stream m_inlineStream{};
+        bool m_inlineStreamReady = false;
+
+        // Workers and the thread that outputs their blocks in order.
+        std::vector<std::thread> m_workers;
+        std::thread m_outputThread;
+
+        // Thread functions. workerIndex is only used to spread the workers across cores.
+        void workerFunction(size_t workerIndex);
+        void outputThreadFunction(void);
+        // Copies the dictionary and data into block and saves the tail of it as the next block's dictionary.
+        void fillBlock(DeflateBlock &block, const unsigned char *data, size_t dataSize, bool isLast);
+        // Passes block's output on and adds it to the stream totals. Returns false if the block or the output failed.
+        bool outputBlock(const DeflateBlock &block);
+        // Compresses block with stream.
+        static void compressBlock(z_stream &stream, DeflateBlock &block);
+};
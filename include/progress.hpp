@@ -0,0 +1,193 @@
+#pragma once
+#include "sdl.hpp"
+#include "strings.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <switch.h>
+
+// Tracks how many bytes of a dump have been written and renders it with the throughput and time remaining.
+class Progress
+{
+    public:
+        // No copying.
+        Progress(const Progress &) = delete;
+        Progress(Progress &&) = delete;
+        Progress &operator=(const Progress &) = delete;
+        Progress &operator=(Progress &&) = delete;
+
+        // Starts tracking a new dump of totalBytes.
+        static void reset(int64_t totalBytes)
+        {
+            Progress &progress = Progress::getInstance();
+            progress.m_totalBytes = totalBytes;
+            progress.m_bytesWritten = 0;
+            progress.m_startTime = Progress::getTimestamp();
+            progress.m_endTime = 0;
+            progress.m_verifiedCount = 0;
+            progress.m_mismatchCount = 0;
+            progress.m_peakMemory = Progress::getUsedMemory();
+            progress.m_isActive = true;
+        }
+
+        // Adds bytes to the total. For work that's only sized up as it goes, like verifying more than one dump.
+        static void addTotalBytes(int64_t bytes)
+        {
+            Progress::getInstance().m_totalBytes += bytes;
+        }
+
+        // Adds bytes to the amount written. This is called from the write threads.
+        static void addBytes(int64_t bytes)
+        {
+            Progress::getInstance().m_bytesWritten += bytes;
+        }
+
+        // Records that an NCA was hashed and checked against its name.
+        static void addVerifiedNca(bool hashMatched)
+        {
+            Progress &progress = Progress::getInstance();
+            ++progress.m_verifiedCount;
+            if (!hashMatched)
+            {
+                ++progress.m_mismatchCount;
+            }
+        }
+
+        // Returns the number of NCAs checked since the last reset.
+        static size_t getVerifiedCount(void)
+        {
+            return Progress::getInstance().m_verifiedCount;
+        }
+
+        // Returns the number of NCAs that didn't match their names since the last reset.
+        static size_t getMismatchCount(void)
+        {
+            return Progress::getInstance().m_mismatchCount;
+        }
+
+        // Returns how long the dump took or has been going in seconds.
+        static double getElapsedSeconds(void)
+        {
+            Progress &progress = Progress::getInstance();
+            int64_t endTime = progress.m_endTime;
+            return static_cast<double>((endTime != 0 ? endTime : Progress::getTimestamp()) - progress.m_startTime) / 1000000000.0;
+        }
+
+        // Returns the most memory the process was seen using since the last reset.
+        static uint64_t getPeakMemory(void)
+        {
+            return Progress::getInstance().m_peakMemory;
+        }
+
+        // Stops the clock. What was rendered last stays up until the next reset.
+        static void finish(void)
+        {
+            Progress &progress = Progress::getInstance();
+            progress.m_endTime = Progress::getTimestamp();
+            Progress::samplePeakMemory();
+        }
+
+        // Renders the progress line under the console.
+        static void render(void)
+        {
+            Progress &progress = Progress::getInstance();
+            if (!progress.m_isActive)
+            {
+                return;
+            }
+
+            // Once a frame is often enough to catch the peak. Nothing is allocated mid-file.
+            if (progress.m_endTime == 0)
+            {
+                Progress::samplePeakMemory();
+            }
+
+            int64_t totalBytes = progress.m_totalBytes;
+            int64_t bytesWritten = progress.m_bytesWritten;
+            int64_t endTime = progress.m_endTime;
+            int64_t elapsed = (endTime != 0 ? endTime : Progress::getTimestamp()) - progress.m_startTime;
+
+            // Average since the start. It's steadier than per-frame and SD writes are bursty anyway.
+            double seconds = static_cast<double>(elapsed) / 1000000000.0;
+            double bytesPerSecond = seconds > 0.0 ? static_cast<double>(bytesWritten) / seconds : 0.0;
+            int64_t secondsRemaining = bytesPerSecond > 0.0 ? static_cast<int64_t>((totalBytes - bytesWritten) / bytesPerSecond) : 0;
+
+            char progressString[0x100] = {0};
+            std::snprintf(progressString,
+                          0x100,
+                          strings::getByName(strings::names::PROGRESS),
+                          static_cast<double>(bytesWritten) / BYTES_PER_MB,
+                          static_cast<double>(totalBytes) / BYTES_PER_MB,
+                          bytesPerSecond / BYTES_PER_MB,
+                          static_cast<unsigned int>(secondsRemaining / 3600),
+                          static_cast<unsigned int>((secondsRemaining / 60) % 60),
+                          static_cast<unsigned int>(secondsRemaining % 60));
+
+            // Rasterizing is the expensive part, so only do it when the line actually changed.
+            if (!progress.m_progressTexture)
+            {
+                progress.m_progressTexture = sdl::TextureManager::createLoadTexture("ProgressTexture", 1168, 52, SDL_TEXTUREACCESS_TARGET);
+            }
+
+            if (std::strcmp(progressString, progress.m_progressString) != 0)
+            {
+                std::memcpy(progress.m_progressString, progressString, sizeof(progressString));
+                progress.m_progressTexture->clear({0x00000000});
+                sdl::text::render(progress.m_progressTexture->get(), 0, 0, 22, sdl::text::NO_TEXT_WRAP, {0xFFFFFFFF}, progressString);
+            }
+            progress.m_progressTexture->render(NULL, 56, 668);
+        }
+
+    private:
+        // No constructing.
+        Progress(void) = default;
+        // Returns instance.
+        static Progress &getInstance(void)
+        {
+            static Progress progress;
+            return progress;
+        }
+
+        // Returns the current time in nanoseconds.
+        static int64_t getTimestamp(void)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // Returns how much memory the process is using right now.
+        static uint64_t getUsedMemory(void)
+        {
+            uint64_t usedMemory = 0;
+            svcGetInfo(&usedMemory, InfoType_UsedMemorySize, CUR_PROCESS_HANDLE, 0);
+            return usedMemory;
+        }
+
+        // Records the memory in use if it's the most seen yet. The render thread and the dump thread both call this.
+        static void samplePeakMemory(void)
+        {
+            Progress &progress = Progress::getInstance();
+            uint64_t usedMemory = Progress::getUsedMemory();
+            uint64_t peakMemory = progress.m_peakMemory;
+            while (usedMemory > peakMemory && !progress.m_peakMemory.compare_exchange_weak(peakMemory, usedMemory)) {}
+        }
+
+        // Bytes in a MB for printing.
+        static constexpr double BYTES_PER_MB = 1024.0 * 1024.0;
+        // Everything is atomic because the render thread reads while the dump threads write.
+        std::atomic<int64_t> m_totalBytes = 0;
+        std::atomic<int64_t> m_bytesWritten = 0;
+        std::atomic<int64_t> m_startTime = 0;
+        std::atomic<int64_t> m_endTime = 0;
+        // NCA verification counts.
+        std::atomic<size_t> m_verifiedCount = 0;
+        std::atomic<size_t> m_mismatchCount = 0;
+        // Most memory the process was seen using.
+        std::atomic<uint64_t> m_peakMemory = 0;
+        // Whether there's anything to render.
+        std::atomic<bool> m_isActive = false;
+        // Last line rendered and the texture it was rendered to. Only the render thread touches these.
+        char m_progressString[0x100] = {0};
+        sdl::SharedTexture m_progressTexture;
+};
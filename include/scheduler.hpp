@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+
+// Decides where biggestDump's threads run while a dump is going. The UI slows down and leaves its core mostly free. Every pipeline's read
+// and write threads get a core each and a bump in priority, and each pipeline starts one core over from the last so they don't all pile
+// onto the same two. Compute threads are spread over every core at the default priority so I/O always gets to go first. Build with make
+// SCHEDULING=0 to leave everything where the OS puts it for comparison.
+namespace scheduler
+{
+    // What a thread does.
+    enum Role
+    {
+        ROLE_UI,
+        ROLE_READ,
+        ROLE_WRITE,
+        // Hashing, deflating and verifying. These aren't pinned, they only start out on their own core.
+        ROLE_COMPUTE
+    };
+
+    // Starts or stops dump mode. ThreadState calls this. The calling thread is assumed to be the UI thread. Stopping puts it back the way
+    // it was before starting.
+    void setDumpActive(bool isActive);
+    // Returns whether a dump is running.
+    bool isDumpActive(void);
+    // Moves the calling thread to role's core and priority. index is which pipeline or worker it belongs to so each one gets its own core.
+    void assignCurrentThread(scheduler::Role role, size_t index = 0);
+    // Called once per frame. While a dump is running, this sleeps until the next capped frame is due.
+    void throttleFrame(void);
+} // namespace scheduler
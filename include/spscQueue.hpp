@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+// Lock-free single producer, single consumer queue. Exactly one thread can push and exactly one thread can pop.
+// CAPACITY must be a power of two.
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+    public:
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two.");
+
+        SpscQueue(void) = default;
+
+        // No copying.
+        SpscQueue(const SpscQueue &) = delete;
+        SpscQueue(SpscQueue &&) = delete;
+        SpscQueue &operator=(const SpscQueue &) = delete;
+        SpscQueue &operator=(SpscQueue &&) = delete;
+
+        // Tries to push value to the queue. Returns false if the queue is full.
+        bool tryPush(const T &value)
+        {
+            size_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+            {
+                return false;
+            }
+            m_queue[tail & (CAPACITY - 1)] = value;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Tries to pop the front of the queue to valueOut. Returns false if the queue is empty.
+        bool tryPop(T &valueOut)
+        {
+            size_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            valueOut = m_queue[head & (CAPACITY - 1)];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Pushes value, waiting for room if the queue is full.
+        void push(const T &value)
+        {
+            for (size_t spinCount = 0; !tryPush(value); spinCount++)
+            {
+                SpscQueue::backOff(spinCount);
+            }
+        }
+
+        // Pops the front of the queue, waiting until there's something to pop.
+        T pop(void)
+        {
+            T value;
+            for (size_t spinCount = 0; !tryPop(value); spinCount++)
+            {
+                SpscQueue::backOff(spinCount);
+            }
+            return value;
+        }
+
+    private:
+        // Head is only written by the consumer, tail only by the producer. Separate cache lines so they don't fight.
+        alignas(64) std::atomic<size_t> m_head = 0;
+        alignas(64) std::atomic<size_t> m_tail = 0;
+        // The actual queue.
+        T m_queue[CAPACITY];
+
+        // Yields for a bit before sleeping so waiting on an SD write doesn't peg a whole core.
+        static void backOff(size_t spinCount)
+        {
+            if (spinCount < 64)
+            {
+                std::this_thread::yield();
+            }
+            else
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include <chrono>
+
+// Tiny helpers for timing how long things take on the wall clock.
+namespace stopwatch
+{
+    // Returns now. Pass it to getMillisecondsSince later.
+    inline std::chrono::steady_clock::time_point start(void)
+    {
+        return std::chrono::steady_clock::now();
+    }
+
+    // Returns how many milliseconds it's been since startTime.
+    inline double getMillisecondsSince(std::chrono::steady_clock::time_point startTime)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    }
+} // namespace stopwatch
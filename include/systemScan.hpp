@@ -0,0 +1,22 @@
+#pragma once
+#include "manifest.hpp"
+#include <string>
+
+// Mounts the system partition and scans sys:/Contents on a thread of its own while the rest of biggestDump starts up. By the time anyone
+// presses a button, the dump already knows what it's in for.
+namespace systemScan
+{
+    // Mounts the system partition as sys:. Mounting changes fslib's device map, which nothing else can be using at the same time, so
+    // this has to be called on the main thread after fslib is initialized and before the logger's thread starts. Returns false if it
+    // couldn't be mounted.
+    bool mount(void);
+    // Starts scanning on its own thread if mount worked. The scan only opens directories and files, same as a dump does next to the
+    // logger.
+    void start(void);
+    // Returns whether the system partition is mounted as sys:. errorStringOut gets what FsLib said if it isn't.
+    bool isMounted(std::string &errorStringOut);
+    // Waits for the scan and copies it to manifestOut. Returns false if it failed or never ran.
+    bool getManifest(Manifest &manifestOut);
+    // Waits for the thread to finish.
+    void exit(void);
+} // namespace systemScan
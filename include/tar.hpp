@@ -0,0 +1,6 @@
+#pragma once
+#include "fslib.hpp"
+#include "manifest.hpp"
+
+// Writes every file in manifest under directoryPath to a new tar at tarPath. Nothing is compressed and the tar is only ever appended to.
+void copyManifestToTar(const Manifest &manifest, const fslib::Path &directoryPath, const char *tarPath);
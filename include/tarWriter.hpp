@@ -0,0 +1,54 @@
+#pragma once
+#include "archiveFile.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Streaming POSIX (pax) tar writer. Tar is just 512 byte headers followed by the data padded to 512 bytes, so this only ever appends and
+// there's nothing to write at the end but two empty blocks. Names or sizes too large for a plain ustar header get a pax header first.
+class TarWriter
+{
+    public:
+        TarWriter(void) = default;
+
+        // No copying.
+        TarWriter(const TarWriter &) = delete;
+        TarWriter(TarWriter &&) = delete;
+        TarWriter &operator=(const TarWriter &) = delete;
+        TarWriter &operator=(TarWriter &&) = delete;
+
+        // Creates a new tar at path on the SD. The file is allocated at reserveSize up front and trimmed to what was actually written at
+        // the end.
+        bool open(const char *path, int64_t reserveSize);
+        // Adds a directory named name.
+        bool addDirectory(const char *name);
+        // Starts a new file entry. name is the path inside the tar. Exactly entrySize bytes are expected to be written to it.
+        bool beginEntry(const char *name, int64_t entrySize);
+        // Writes data to the current entry.
+        bool write(const void *data, size_t dataSize);
+        // Ends the current entry. If less than entrySize was written, the rest is filled with zeros so the tar stays readable.
+        bool endEntry(void);
+        // Writes the end of archive blocks and closes the tar.
+        bool close(void);
+
+        // Returns exactly how many bytes a file named name that's dataSize bytes long adds to a tar. Used to size the reservation.
+        static int64_t getEntrySize(const char *name, int64_t dataSize);
+        // Returns how many bytes a directory named name adds to a tar.
+        static int64_t getDirectorySize(const char *name);
+        // Returns the size of the end of archive blocks.
+        static int64_t getEndRecordSize(void);
+
+    private:
+        // File being written.
+        ArchiveFile m_file{"tar"};
+        // Modification time stamped on every entry.
+        uint64_t m_modificationTime = 0;
+
+        // Size the current entry's header says it is and how much has actually been written to it.
+        int64_t m_entrySize = 0;
+        int64_t m_entryWritten = 0;
+
+        // Writes the header(s) for name. typeFlag is the ustar type.
+        bool writeHeader(const char *name, int64_t entrySize, char typeFlag);
+        // Writes zeroSize zeros.
+        bool writeZeros(int64_t zeroSize);
+};
@@ -4,6 +4,20 @@ namespace thread
 {
     // Dumps firmware to the sd card in a folder. The bool passed is so the function can signal it's finished.
     void dumpToFolder(bool *isRunning);
+    // Dumps firmware to the same folder, but skips everything the last dump's manifest says is already there and intact.
+    void resumeDumpToFolder(bool *isRunning);
     // Dumps firmware, but writes it to a zip uncompressed. Bool is same as above.
     void dumpToZip(bool *isRunning);
+    // Dumps firmware to a zip, but deflates it on every core at once.
+    void dumpToCompressedZip(bool *isRunning);
+    // Dumps firmware to a tar. Nothing but sequential writes.
+    void dumpToTar(bool *isRunning);
+    // Dumps firmware to several ZIPs small enough for FAT32, written at the same time.
+    void dumpToSplitZip(bool *isRunning);
+    // Dumps only what's new or changed since the last folder dump to its own folder. Everything else is listed in a reference file.
+    void dumpDeltaToFolder(bool *isRunning);
+    // Reads the folder dump and the ZIP dump back, whichever are there, and checks every file in them. Nothing is written.
+    void verifyDump(bool *isRunning);
+    // Dumps only the NCAs the newest system update references, according to the system's content meta database, plus an index of them.
+    void dumpPendingUpdate(bool *isRunning);
 } // namespace thread
@@ -0,0 +1,50 @@
+#pragma once
+// Scoped timing events for figuring out where a dump's time goes. Build with make TRACE=1 to turn this on. Otherwise every macro here is
+// empty and none of it is compiled in.
+#ifdef BIGGESTDUMP_TRACE
+#include <cstdint>
+
+namespace trace
+{
+    // Returns the current time in nanoseconds.
+    int64_t getTimestamp(void);
+    // Records an event named name from startTime to endTime on the calling thread. name must be a string literal.
+    void record(const char *name, int64_t startTime, int64_t endTime);
+    // Names the calling thread in the trace. name must be a string literal.
+    void setThreadName(const char *name);
+    // Writes everything recorded so far next to the log as Chrome trace JSON and starts over. Nothing else should be tracing when this is
+    // called.
+    void dump(void);
+
+    // Records an event for as long as it's in scope.
+    class Scope
+    {
+        public:
+            Scope(const char *name) : m_name(name), m_startTime(trace::getTimestamp()) {};
+            ~Scope()
+            {
+                trace::record(m_name, m_startTime, trace::getTimestamp());
+            }
+
+            // No copying.
+            Scope(const Scope &) = delete;
+            Scope(Scope &&) = delete;
+            Scope &operator=(const Scope &) = delete;
+            Scope &operator=(Scope &&) = delete;
+
+        private:
+            const char *m_name;
+            int64_t m_startTime;
+    };
+} // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) trace::setThreadName(name)
+#define TRACE_DUMP() trace::dump()
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#define TRACE_DUMP()
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// This is where a CopyEngine's write thread sends what was read. The folder dump writes files, the ZIP dump writes entries. A sink is only
+// ever used by one write thread, so it doesn't need to lock anything itself.
+class TransferSink
+{
+    public:
+        TransferSink(void) = default;
+        virtual ~TransferSink() {};
+
+        // Starts a file of fileSize bytes read from source. Returns false if it can't be written. endFile() isn't called if this fails.
+        virtual bool beginFile(const fslib::Path &source, const fslib::Path &destination, int64_t fileSize) = 0;
+        // Returns whether endFile() needs crc. The hash thread skips working it out if it doesn't.
+        virtual bool needsCrc(void) const
+        {
+            return false;
+        }
+        // Writes a chunk of the current file. Returns false on failure.
+        virtual bool write(const unsigned char *data, size_t dataSize) = 0;
+        // Ends the current file. crc and hash are the CRC32 and SHA-256 of the whole source, but crc is zero unless needsCrc() is true.
+        // isComplete is false if the file came up short or didn't pass verification. Returns false on failure.
+        virtual bool endFile(uint32_t crc, const uint8_t *hash, bool isComplete) = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// A single file or directory found by TreeWalker.
+struct TreeRecord
+{
+        // Path relative to the root being walked. Only good until the record function returns.
+        const char *path = nullptr;
+        size_t pathLength = 0;
+        // Size in bytes. Always zero for directories.
+        int64_t size = 0;
+        bool isDirectory = false;
+};
+
+// Walks a directory tree without recursing. Directories waiting to be opened are kept on a stack with their paths packed into one
+// buffer, and every path handed out is built in place in another, so only one directory is ever open at a time and the walk's own
+// bookkeeping doesn't allocate per entry. Opening each file and directory still copies its path into m_openPath, and whatever the record
+// function keeps is up to it. Manifest keeps a std::string per entry.
+class TreeWalker
+{
+    public:
+        // Function records are streamed to as they're found.
+        using RecordFunction = std::function<void(const TreeRecord &)>;
+
+        TreeWalker(void);
+
+        // No copying.
+        TreeWalker(const TreeWalker &) = delete;
+        TreeWalker(TreeWalker &&) = delete;
+        TreeWalker &operator=(const TreeWalker &) = delete;
+        TreeWalker &operator=(TreeWalker &&) = delete;
+
+        // Walks everything under root and passes it to recordFunction. Directories always come before what's in them. Returns false if
+        // root couldn't be opened. Anything under it that can't be opened is logged and skipped.
+        bool walk(const fslib::Path &root, const RecordFunction &recordFunction);
+
+    private:
+        // What the arena starts out with. Firmware trees never get close, so it never grows.
+        static constexpr size_t ARENA_RESERVE_SIZE = 0x4000;
+
+        // Relative paths of the directories waiting to be opened, NUL terminated and packed end to end. Popping always takes the last one,
+        // so the arena is just cut back to where it started.
+        std::vector<char> m_arena;
+        // Where each waiting directory's path starts in m_arena.
+        std::vector<size_t> m_pendingDirectories;
+
+        // Full path of whatever is being looked at. The root is written once and everything after it is rewritten in place.
+        char m_pathBuffer[FS_MAX_PATH] = {0};
+        // Where the relative part of m_pathBuffer starts.
+        size_t m_relativeOffset = 0;
+
+        // Reused for every directory and file. Each path is still copied in to open it, but nothing has to be built from scratch.
+        fslib::Path m_openPath;
+        fslib::Directory m_directory;
+        fslib::File m_file;
+
+        // Writes name after the first directoryLength bytes of the relative path in m_pathBuffer. Returns the new relative length or 0 if it
+        // doesn't fit.
+        size_t appendName(size_t directoryLength, const char *name);
+        // Records everything in m_directory and pushes its subdirectories. directoryLength is the length of its relative path.
+        void walkDirectory(size_t directoryLength, const RecordFunction &recordFunction);
+};
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Reads what a system update is made of out of the system's content meta database. The CNMTs in the NCAs are encrypted, but ncm has
+// already parsed every one of them, so it's asked instead.
+namespace updateMeta
+{
+    // An NCA a system update needs.
+    struct UpdateContent
+    {
+            // Title the NCA belongs to and that title's version.
+            uint64_t titleId = 0;
+            uint32_t version = 0;
+            // Content ID as 32 lowercase hex digits. This is the NCA's file name without .nca.
+            std::string contentId;
+            // Whether this is the title's CNMT rather than its data.
+            bool isMeta = false;
+    };
+
+    // Finds the newest SystemUpdate in the system's content meta database and everything it references. isPendingOut is set if ns says
+    // a downloaded update is waiting to be installed. Returns false if the database couldn't be read.
+    bool getLatestSystemUpdate(uint32_t &versionOut, bool &isPendingOut, std::vector<updateMeta::UpdateContent> &contentsOut);
+} // namespace updateMeta
@@ -0,0 +1,48 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <switch.h>
+#include <vector>
+
+// One thing to check. Either a whole file in a folder dump or one entry in a ZIP.
+struct VerifyJob
+{
+        // What it's reported as. This is the path inside the dump, so it's also what the NCA check goes by.
+        std::string name;
+        // File on the SD its data is in.
+        fslib::Path path;
+        // Where its data starts in path and how many bytes of it there are.
+        int64_t offset = 0;
+        int64_t size = 0;
+        // Deflated ZIP entries are inflated as they're read. uncompressedSize is what they should come out to.
+        bool isDeflated = false;
+        int64_t uncompressedSize = 0;
+        // ZIP entries have a CRC32 to check. Folder dumps don't.
+        bool hasCrc = false;
+        uint32_t crc = 0;
+        // Folder dumps have the SHA-256 the manifest recorded when the file was written instead.
+        bool hasHash = false;
+        uint8_t hash[SHA256_HASH_SIZE] = {0};
+};
+
+// How a verify went.
+struct VerifyResult
+{
+        // Files checked and how many of them are damaged.
+        size_t checkedCount = 0;
+        size_t failedCount = 0;
+        // NCAs hashed and how many didn't match their names.
+        size_t ncaCount = 0;
+        size_t ncaMismatchCount = 0;
+};
+
+// Reads every job back on threadCount threads at once and checks it. Every failure is printed to the console as it's found. Results are
+// added to resultOut. The jobs' sizes are added to Progress's total, so reset it once before the first call.
+void verifyJobs(std::vector<VerifyJob> &jobs, size_t threadCount, VerifyResult &resultOut);
+
+// Walks the folder dump at folderPath and checks every file against the SHA-256 the manifest at manifestPath has for it, and every NCA
+// against its name. Files the manifest doesn't have and files it has that are gone both count as damaged. Without a manifest only the NCAs
+// can be checked. Returns false if the folder couldn't be walked.
+bool verifyFolder(const fslib::Path &folderPath, const fslib::Path &manifestPath, size_t threadCount, VerifyResult &resultOut);
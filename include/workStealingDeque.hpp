@@ -0,0 +1,56 @@
+#pragma once
+#include <deque>
+#include <mutex>
+
+// Deque each worker owns. The owner pushes and pops at the back, other workers steal from the front so they take the oldest work and
+// stay out of the owner's way. What the oldest work is depends on the order it was pushed in. The copy engines push smallest first, so
+// thieves only ever pick up the small stuff.
+template <typename T>
+class WorkStealingDeque
+{
+    public:
+        WorkStealingDeque(void) = default;
+
+        // No copying.
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque(WorkStealingDeque &&) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(WorkStealingDeque &&) = delete;
+
+        // Pushes value to the back of the deque. Only the owner should call this.
+        void push(T value)
+        {
+            std::lock_guard<std::mutex> dequeLock(m_dequeMutex);
+            m_deque.push_back(std::move(value));
+        }
+
+        // Pops from the back of the deque. Only the owner should call this. Returns false if the deque is empty.
+        bool pop(T &valueOut)
+        {
+            std::lock_guard<std::mutex> dequeLock(m_dequeMutex);
+            if (m_deque.empty())
+            {
+                return false;
+            }
+            valueOut = std::move(m_deque.back());
+            m_deque.pop_back();
+            return true;
+        }
+
+        // Steals from the front of the deque. Any other worker can call this. Returns false if the deque is empty.
+        bool steal(T &valueOut)
+        {
+            std::lock_guard<std::mutex> dequeLock(m_dequeMutex);
+            if (m_deque.empty())
+            {
+                return false;
+            }
+            valueOut = std::move(m_deque.front());
+            m_deque.pop_front();
+            return true;
+        }
+
+    private:
+        std::mutex m_dequeMutex;
+        std::deque<T> m_deque;
+};
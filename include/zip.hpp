@@ -1,4 +1,21 @@
 #pragma once
 #include "fslib.hpp"
+#include "manifest.hpp"
+#include "verify.hpp"
 
-void copyDirectoryToZip(const fslib::Path &directoryPath, const char *zipPath);
+// Writes every file in manifest under directoryPath to a new ZIP at zipPath. compressionLevel is a zlib level. Z_NO_COMPRESSION (0) stores
+// files as-is, anything else deflates them on every core at once.
+void copyManifestToZip(const Manifest &manifest, const fslib::Path &directoryPath, const char *zipPath, int compressionLevel = 0);
+
+// Same as above, but split across as many stored ZIPs as it takes to keep each one under volumeSize bytes. Every volume is a complete ZIP
+// named zipPathBase.partNN.zip. Volumes are planned up front from the manifest and writerCount of them are written at once. Nothing is
+// written if a volume that size can't hold the largest file.
+void copyManifestToSplitZip(const Manifest &manifest,
+                            const fslib::Path &directoryPath,
+                            const char *zipPathBase,
+                            int64_t volumeSize,
+                            size_t writerCount);
+
+// Reads the central directory of the ZIP at zipPath and checks every entry's CRC32 on threadCount threads. NCAs are checked against their
+// names too. Returns false if the ZIP couldn't be opened or its central directory is damaged.
+bool verifyZip(const char *zipPath, size_t threadCount, VerifyResult &resultOut);
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+// The ZIP records biggestDump writes and reads back. ZipWriter and verifyZip both go through these so they can't disagree.
+namespace zipFormat
+{
+    // Record signatures.
+    static constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+    static constexpr uint32_t DATA_DESCRIPTOR_SIGNATURE = 0x08074B50;
+    static constexpr uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014B50;
+    static constexpr uint32_t ZIP64_END_SIGNATURE = 0x06064B50;
+    static constexpr uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064B50;
+    static constexpr uint32_t END_SIGNATURE = 0x06054B50;
+
+    // ZIP64 needs 4.5.
+    static constexpr uint16_t ZIP_VERSION = 45;
+    // Bit 3: CRC and sizes are in the data descriptor after the data.
+    static constexpr uint16_t FLAG_DATA_DESCRIPTOR = 0x0008;
+    // Compression methods.
+    static constexpr uint16_t METHOD_STORED = 0;
+    static constexpr uint16_t METHOD_DEFLATED = 8;
+    // ID of the ZIP64 extra field.
+    static constexpr uint16_t ZIP64_EXTRA_ID = 0x0001;
+    // Sizes and offsets set to this are really in the ZIP64 extra field.
+    static constexpr uint32_t ZIP64_MARKER = 0xFFFFFFFF;
+
+    // Fixed sizes of every record. Local headers and central headers are followed by the name and a ZIP64 extra field.
+    static constexpr int64_t LOCAL_HEADER_SIZE = 30;
+    static constexpr int64_t LOCAL_ZIP64_EXTRA_SIZE = 20;
+    static constexpr int64_t DATA_DESCRIPTOR_SIZE = 24;
+    static constexpr int64_t CENTRAL_HEADER_SIZE = 46;
+    static constexpr int64_t CENTRAL_ZIP64_EXTRA_SIZE = 28;
+    static constexpr int64_t ZIP64_END_SIZE = 56;
+    static constexpr int64_t ZIP64_LOCATOR_SIZE = 20;
+    static constexpr int64_t END_SIZE = 22;
+} // namespace zipFormat
@@ -0,0 +1,53 @@
+#pragma once
+#include "archiveFile.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Streaming ZIP64 writer. Data is written straight to the SD from the caller's buffers, every entry ends with a data descriptor so
+// nothing ever has to seek back, and the central directory is built in memory and written in one go at the end.
+class ZipWriter
+{
+    public:
+        ZipWriter(void) = default;
+
+        // No copying.
+        ZipWriter(const ZipWriter &) = delete;
+        ZipWriter(ZipWriter &&) = delete;
+        ZipWriter &operator=(const ZipWriter &) = delete;
+        ZipWriter &operator=(ZipWriter &&) = delete;
+
+        // Creates a new ZIP at path on the SD. The file is allocated at reserveSize up front and trimmed to what was actually written at
+        // the end.
+        bool open(const char *path, int64_t reserveSize);
+        // Starts a new entry. name is the path inside the ZIP. If isDeflated is true, data passed to write() is a raw deflate stream.
+        bool beginEntry(const char *name, bool isDeflated);
+        // Writes data to the current entry.
+        bool write(const void *data, size_t dataSize);
+        // Ends the current entry. crc and uncompressedSize are of the original data.
+        bool endEntry(uint32_t crc, uint64_t uncompressedSize);
+        // Writes the central directory and closes the ZIP.
+        bool close(void);
+
+        // Returns exactly how many bytes a stored entry named name that's dataSize bytes long adds to a ZIP. Used to size the reservation.
+        static int64_t getStoredEntrySize(const char *name, int64_t dataSize);
+        // Returns the size of the records at the end of the ZIP after the central directory.
+        static int64_t getEndRecordSize(void);
+
+    private:
+        // File being written.
+        ArchiveFile m_file{"ZIP"};
+        // DOS time and date stamped on every entry.
+        uint16_t m_dosTime = 0, m_dosDate = 0;
+
+        // Current entry.
+        std::string m_entryName;
+        bool m_entryIsDeflated = false;
+        int64_t m_entryOffset = 0;
+        uint64_t m_entryCompressedSize = 0;
+
+        // Central directory records built up as entries finish.
+        std::vector<uint8_t> m_centralDirectory;
+        uint64_t m_entryCount = 0;
+};
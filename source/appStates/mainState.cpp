@@ -6,6 +6,7 @@
 #include "input.hpp"
 #include "logger.hpp"
 #include "strings.hpp"
+#include "systemScan.hpp"
 #include "threadFunctions.hpp"
 #include "zip.hpp"
 #include <switch.h>
@@ -13,16 +14,20 @@
 namespace
 {
     const char *FIRMWARE_FOLDER = "sdmc:/FirmwareDump";
+    const char *FIRMWARE_DELTA_FOLDER = "sdmc:/FirmwareDelta";
+    const char *PENDING_UPDATE_FOLDER = "sdmc:/PendingUpdate";
 }
 
 MainState::MainState(void)
 {
     Console::printf(strings::getByName(strings::names::WELCOME));
 
-    // Try to mount system partition.
-    if (!(m_systemMounted = fslib::openBisFileSystem("sys", FsBisPartitionId_System)))
+    // The system partition is mounted before anything else at startup. The scan might still be going, but that's only waited on once a
+    // dump starts.
+    std::string errorString;
+    if (!(m_systemMounted = systemScan::isMounted(errorString)))
     {
-        Console::printf("*%s*: %s", fslib::getErrorString(), strings::getByName(strings::names::QUIT));
+        Console::printf("*%s*: %s", errorString.c_str(), strings::getByName(strings::names::QUIT));
     }
     else
     {
@@ -48,11 +53,71 @@ void MainState::update(void)
         }
         BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpToFolder));
     }
+    else if (input::buttonPressed(HidNpadButton_Y) && m_systemMounted)
+    {
+        // This one keeps whatever is already there. The folder might not exist yet if this is the first run.
+        if (!fslib::directoryExists(FIRMWARE_FOLDER) && !fslib::createDirectory(FIRMWARE_FOLDER))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+            return;
+        }
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::resumeDumpToFolder));
+    }
     else if (input::buttonPressed(HidNpadButton_X) && m_systemMounted)
     {
         // I don't think this cares about there being a previous backup.
         BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpToZip));
     }
+    else if (input::buttonPressed(HidNpadButton_R) && m_systemMounted)
+    {
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpToCompressedZip));
+    }
+    else if (input::buttonPressed(HidNpadButton_L) && m_systemMounted)
+    {
+        // Same as the ZIP. Whatever tar was there gets replaced.
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpToTar));
+    }
+    else if (input::buttonPressed(HidNpadButton_ZL) && m_systemMounted)
+    {
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpToSplitZip));
+    }
+    else if (input::buttonPressed(HidNpadButton_ZR) && m_systemMounted)
+    {
+        // Deltas always start clean like [A]. The full dump in FIRMWARE_FOLDER is left alone.
+        if (fslib::directoryExists(FIRMWARE_DELTA_FOLDER) && !fslib::deleteDirectoryRecursively(FIRMWARE_DELTA_FOLDER))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+            return;
+        }
+
+        if (!fslib::createDirectory(FIRMWARE_DELTA_FOLDER))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+            return;
+        }
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpDeltaToFolder));
+    }
+    else if (input::buttonPressed(HidNpadButton_B) && m_systemMounted)
+    {
+        // Same deal as the delta. A leftover NCA from some other update would only confuse whatever installs this.
+        if (fslib::directoryExists(PENDING_UPDATE_FOLDER) && !fslib::deleteDirectoryRecursively(PENDING_UPDATE_FOLDER))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+            return;
+        }
+
+        if (!fslib::createDirectory(PENDING_UPDATE_FOLDER))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+            return;
+        }
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::dumpPendingUpdate));
+    }
+    else if (input::buttonPressed(HidNpadButton_Minus))
+    {
+        // Only reads from the SD, so it doesn't need the system mounted.
+        BiggestDump::pushState(std::make_shared<ThreadState>(thread::verifyDump));
+    }
     else if (input::buttonPressed(HidNpadButton_Plus))
     {
         BiggestDump::quit();
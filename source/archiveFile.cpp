@@ -0,0 +1,61 @@
+#include "archiveFile.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+
+ArchiveFile::ArchiveFile(const char *kind) : m_kind(kind) {}
+
+bool ArchiveFile::open(const char *path, int64_t reserveSize)
+{
+    // Create replaces whatever was there and sizes the new file in one go.
+    if (!m_file.open(path, FsOpenMode_Create | FsOpenMode_Write, reserveSize))
+    {
+        LOG_ERROR("Error creating %s \"%s\": %s", m_kind, path, fslib::getErrorString());
+        return false;
+    }
+    m_offset = 0;
+    return true;
+}
+
+bool ArchiveFile::write(const void *data, size_t dataSize)
+{
+    TRACE_SCOPE("archiveWrite");
+    if (!m_file.isOpen())
+    {
+        return false;
+    }
+
+    if (m_file.write(data, dataSize) != static_cast<ssize_t>(dataSize))
+    {
+        LOG_ERROR("Error writing to %s at offset 0x%llX: %s", m_kind, static_cast<unsigned long long>(m_offset), fslib::getErrorString());
+        return false;
+    }
+    m_offset += dataSize;
+    return true;
+}
+
+bool ArchiveFile::close(void)
+{
+    if (!m_file.isOpen())
+    {
+        return false;
+    }
+
+    // Trim off whatever was reserved and not used.
+    bool closed = m_file.resize(m_offset) && m_file.flush();
+    if (!closed)
+    {
+        LOG_ERROR("Error closing %s: %s", m_kind, fslib::getErrorString());
+    }
+    m_file.close();
+    return closed;
+}
+
+bool ArchiveFile::isOpen(void) const
+{
+    return m_file.isOpen();
+}
+
+int64_t ArchiveFile::getOffset(void) const
+{
+    return m_offset;
+}
@@ -1,12 +1,18 @@
 #include "biggestDump.hpp"
 #include "appStates/mainState.hpp"
+#include "bufferPool.hpp"
 #include "console.hpp"
 #include "fslib.hpp"
 #include "input.hpp"
 #include "logger.hpp"
+#include "progress.hpp"
 #include "sdl.hpp"
+#include "stopwatch.hpp"
 #include "strings.hpp"
+#include "systemScan.hpp"
+#include "trace.hpp"
 #include <switch.h>
+#include <vector>
 
 namespace
 {
@@ -16,48 +22,111 @@ namespace
     static constexpr sdl::Color RED = {0xFF0000FF};
     static constexpr sdl::Color GREEN = {0x00FF00FF};
     static constexpr sdl::Color YELLOW = {0xF8FC00FF};
+
+    // A step of startup and how long it took.
+    struct StartupStep
+    {
+            const char *name;
+            double milliseconds;
+    };
+
+    // Every step the constructor timed. These are logged once the first frame is up.
+    std::vector<StartupStep> s_startupSteps;
+    // When biggestDump started and whether the time to the first frame was logged yet.
+    std::chrono::steady_clock::time_point s_launchTime;
+    bool s_firstFrameLogged = false;
 } // namespace
 
+// Runs step and records how long it took as stepName. Returns what step returns.
+template <typename StepFunction>
+static bool runStartupStep(const char *stepName, StepFunction step)
+{
+    TRACE_SCOPE(stepName);
+    auto stepStart = stopwatch::start();
+    bool stepSucceeded = step();
+    s_startupSteps.push_back({stepName, stopwatch::getMillisecondsSince(stepStart)});
+    return stepSucceeded;
+}
+
+// Logs every step startup took and how long it was until the first frame. Some of the steps happen before there's a log to write to.
+static void logStartupSteps(void)
+{
+    for (const StartupStep &step : s_startupSteps)
+    {
+        LOG_INFO("Startup: %s took %.2f ms.", step.name, step.milliseconds);
+    }
+    LOG_INFO("Startup: first frame was up %.2f ms after launch.", stopwatch::getMillisecondsSince(s_launchTime));
+    s_startupSteps.clear();
+    s_firstFrameLogged = true;
+}
+
 BiggestDump::BiggestDump()
 {
+    s_launchTime = stopwatch::start();
+
     // Init FsLib because it's the most important thing.
-    if (!fslib::initialize())
+    if (!runStartupStep("fslib", []() { return fslib::initialize(); }))
     {
         return;
     }
 
-    // This will create a blank log to start.
-    logger::initialize();
+    // Mounting changes fslib's device map, and fslib doesn't guard that. It has to be done before the logger's thread starts writing
+    // through it. MainState reports it if it fails.
+    runStartupStep("mountSystem", []() { return systemScan::mount(); });
 
-    // RomFS is here because I don't have time to write my own thing for it.
-    if (R_FAILED(romfsInit()))
+    // This will create a blank log to start and get the thread that writes it going.
+    runStartupStep("logger", []() {
+        logger::initialize();
+        return true;
+    });
+
+    // Shutdown fs_dev
+    if (!runStartupStep("fslib::dev", []() { return fslib::dev::initializeSDMC(); }))
     {
-        logger::log("Error opening romfs.");
+        LOG_ERROR("Error intializing fslib::dev.");
         return;
     }
 
-    // Shutdown fs_dev
-    if (!fslib::dev::initializeSDMC())
+    // Every transfer buffer for the rest of the run comes out of this, so it's sized before anything else takes a bite of the heap.
+    if (!runStartupStep("bufferPool", []() { return bufferPool::initialize(); }))
+    {
+        return;
+    }
+
+    // sys:/Contents gets scanned on its own thread while everything below gets going. Nothing below mounts anything or opens anything
+    // through fslib, and the scan only reads through the mount it already has.
+    systemScan::start();
+
+    // RomFS is here because I don't have time to write my own thing for it.
+    if (!runStartupStep("romfs", []() { return R_SUCCEEDED(romfsInit()); }))
     {
-        logger::log("Error intializing fslib::dev.");
+        LOG_ERROR("Error opening romfs.");
         return;
     }
 
-    // SDL for rendering and text.
-    if (!sdl::initialize("biggestDump", 1280, 720) || !sdl::text::initialize())
+    // SDL for rendering and text. Loading the font is the slow part.
+    if (!runStartupStep("sdl", []() { return sdl::initialize("biggestDump", 1280, 720); }) ||
+        !runStartupStep("freetype", []() { return sdl::text::initialize(); }))
     {
-        logger::log("Error initializing SDL and/or FreeType: %s.", sdl::getErrorString());
+        LOG_ERROR("Error initializing SDL and/or FreeType: %s.", sdl::getErrorString());
         return;
     }
 
-    // Load strings from file.
-    strings::initialize();
+    // Pick the strings for the system's language.
+    runStartupStep("strings", []() {
+        strings::initialize();
+        return true;
+    });
 
     // Game pad stuff.
-    input::initialize();
+    runStartupStep("input", []() {
+        input::initialize();
+        return true;
+    });
 
     // Setup console.
     Console::setXY(56, 94);
+    Console::setSize(1168, 554);
     Console::setFontSize(22);
     Console::setMaxLineCount(19);
 
@@ -66,7 +135,18 @@ BiggestDump::BiggestDump()
     sdl::text::addColorCharacter(L'<', YELLOW);
     sdl::text::addColorCharacter(L'>', GREEN);
 
-    BiggestDump::pushState(std::make_shared<MainState>());
+    // The title and lines never change, so they're only rendered once.
+    sm_chromeTexture = sdl::TextureManager::createLoadTexture("ChromeTexture", 1280, 720, SDL_TEXTUREACCESS_TARGET);
+    sm_chromeTexture->clear({0x00000000});
+    sdl::renderLine(sm_chromeTexture->get(), 30, 88, 1250, 88, WHITE);
+    sdl::renderLine(sm_chromeTexture->get(), 30, 648, 1250, 648, WHITE);
+    sdl::text::render(sm_chromeTexture->get(), 130, 26, 34, sdl::text::NO_TEXT_WRAP, WHITE, "biggestDump *Z*: Resurrection");
+
+    // The mount's already done. The scan can keep going until someone actually starts a dump.
+    runStartupStep("mainState", []() {
+        BiggestDump::pushState(std::make_shared<MainState>());
+        return true;
+    });
 
     // Should be good to go?
     sm_isRunning = true;
@@ -74,6 +154,11 @@ BiggestDump::BiggestDump()
 
 BiggestDump::~BiggestDump()
 {
+    // The scan might still be logging, so it goes before the log. Log goes next so everything still waiting makes it to the SD before
+    // fslib is gone.
+    systemScan::exit();
+    bufferPool::exit();
+    logger::exit();
     romfsExit();
     sdl::text::exit();
     sdl::exit();
@@ -102,12 +187,16 @@ void BiggestDump::update(void)
 void BiggestDump::render(void)
 {
     sdl::frameBegin(CLEAR);
-    // This is the very base of biggestDump's UI(?)
-    sdl::renderLine(NULL, 30, 88, 1250, 88, WHITE);
-    sdl::renderLine(NULL, 30, 648, 1250, 648, WHITE);
-    sdl::text::render(NULL, 130, 26, 34, sdl::text::NO_TEXT_WRAP, WHITE, "biggestDump *Z*: Resurrection");
+    // This is the very base of biggestDump's UI(?) Everything here is a cached texture that's only redrawn when it changes.
+    sm_chromeTexture->render(NULL, 0, 0);
     Console::render();
+    Progress::render();
     sdl::frameEnd();
+
+    if (!s_firstFrameLogged)
+    {
+        logStartupSteps();
+    }
 }
 
 void BiggestDump::quit(void)
@@ -0,0 +1,174 @@
+#include "bufferPool.hpp"
+#include "logger.hpp"
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+#ifdef __SWITCH__
+#include <switch.h>
+#endif
+
+namespace
+{
+    // The pool gets this fraction of whatever memory is left when it's created.
+    constexpr size_t BUDGET_DIVISOR = 4;
+    // Never less than this. Two engines at once still get four slots each.
+    constexpr size_t MIN_BUDGET = 0x1000000;
+    static_assert(MIN_BUDGET / bufferPool::MAX_BUFFER_SIZE >= bufferPool::MIN_BUFFER_COUNT,
+                  "The smallest pool has to hold MIN_BUFFER_COUNT of the biggest buffers.");
+    // Past this, the SD can't keep up anyway.
+    constexpr size_t MAX_BUDGET = 0x4000000;
+    // Applet mode shares its memory with the album and the homebrew menu, so it gets less no matter what's free.
+    constexpr size_t APPLET_MAX_BUDGET = 0x1800000;
+
+    // The one big allocation every buffer lives in.
+    unsigned char *s_poolMemory = nullptr;
+    size_t s_poolSize = 0;
+    // What it's carved into right now.
+    size_t s_bufferSize = 0;
+    size_t s_bufferCount = 0;
+    // Buffers nobody has right now.
+    std::vector<unsigned char *> s_freeBuffers;
+    std::mutex s_poolMutex;
+    // Signaled whenever buffers are released.
+    std::condition_variable s_releaseCondition;
+} // namespace
+
+// Returns how much memory the pool is allowed.
+static size_t getBudget(void)
+{
+    size_t budget = MIN_BUDGET;
+    size_t maxBudget = MAX_BUDGET;
+#ifdef __SWITCH__
+    uint64_t totalMemory = 0, usedMemory = 0;
+    if (R_SUCCEEDED(svcGetInfo(&totalMemory, InfoType_TotalMemorySize, CUR_PROCESS_HANDLE, 0)) &&
+        R_SUCCEEDED(svcGetInfo(&usedMemory, InfoType_UsedMemorySize, CUR_PROCESS_HANDLE, 0)) && totalMemory > usedMemory)
+    {
+        budget = (totalMemory - usedMemory) / BUDGET_DIVISOR;
+    }
+
+    AppletType appletType = appletGetAppletType();
+    if (appletType != AppletType_Application && appletType != AppletType_SystemApplication)
+    {
+        maxBudget = APPLET_MAX_BUDGET;
+    }
+#endif
+    return budget < MIN_BUDGET ? MIN_BUDGET : (budget > maxBudget ? maxBudget : budget);
+}
+
+// Fills s_freeBuffers with s_poolMemory cut into bufferSize pieces. s_poolMutex has to be held if anything else could be using the pool.
+static void carvePool(size_t bufferSize)
+{
+    s_bufferSize = bufferSize;
+    s_bufferCount = s_poolSize / bufferSize;
+    s_freeBuffers.clear();
+    for (size_t i = 0; i < s_bufferCount; i++)
+    {
+        s_freeBuffers.push_back(&s_poolMemory[i * bufferSize]);
+    }
+}
+
+bool bufferPool::initialize(void)
+{
+    // Whole max size buffers so every size it can be carved into fits evenly enough.
+    size_t poolSize = getBudget() / bufferPool::MAX_BUFFER_SIZE * bufferPool::MAX_BUFFER_SIZE;
+    s_poolMemory = static_cast<unsigned char *>(std::aligned_alloc(bufferPool::BUFFER_ALIGNMENT, poolSize));
+    if (!s_poolMemory)
+    {
+        LOG_ERROR("Error allocating 0x%lX byte buffer pool.", static_cast<unsigned long>(poolSize));
+        return false;
+    }
+
+    s_poolSize = poolSize;
+    carvePool(bufferPool::MAX_BUFFER_SIZE);
+    LOG_INFO("Buffer pool: 0x%lX bytes.", static_cast<unsigned long>(s_poolSize));
+    return true;
+}
+
+void bufferPool::exit(void)
+{
+    std::lock_guard<std::mutex> poolLock(s_poolMutex);
+    if (s_freeBuffers.size() != s_bufferCount)
+    {
+        LOG_WARNING("Buffer pool freed with %lu buffers still out!", static_cast<unsigned long>(s_bufferCount - s_freeBuffers.size()));
+    }
+    std::free(s_poolMemory);
+    s_poolMemory = nullptr;
+    s_poolSize = 0;
+    s_bufferSize = 0;
+    s_bufferCount = 0;
+    s_freeBuffers.clear();
+}
+
+bool bufferPool::setBufferSize(size_t bufferSize)
+{
+    bufferSize = (bufferSize + bufferPool::BUFFER_ALIGNMENT - 1) / bufferPool::BUFFER_ALIGNMENT * bufferPool::BUFFER_ALIGNMENT;
+    if (bufferSize == 0)
+    {
+        bufferSize = bufferPool::BUFFER_ALIGNMENT;
+    }
+    else if (bufferSize > bufferPool::MAX_BUFFER_SIZE)
+    {
+        bufferSize = bufferPool::MAX_BUFFER_SIZE;
+    }
+
+    std::lock_guard<std::mutex> poolLock(s_poolMutex);
+    if (bufferSize == s_bufferSize)
+    {
+        return true;
+    }
+    else if (s_freeBuffers.size() != s_bufferCount)
+    {
+        LOG_ERROR("Can't resize buffer pool with %lu buffers still out.", static_cast<unsigned long>(s_bufferCount - s_freeBuffers.size()));
+        return false;
+    }
+
+    carvePool(bufferSize);
+    LOG_DEBUG("Buffer pool carved into %lu 0x%lX byte buffers.",
+              static_cast<unsigned long>(s_bufferCount),
+              static_cast<unsigned long>(s_bufferSize));
+    return true;
+}
+
+size_t bufferPool::getBufferSize(void)
+{
+    return s_bufferSize;
+}
+
+size_t bufferPool::getBufferCount(void)
+{
+    return s_bufferCount;
+}
+
+bool bufferPool::acquire(unsigned char **buffersOut, size_t count)
+{
+    // All or nothing. Taking them a few at a time could leave two engines each holding half and waiting on the other.
+    std::unique_lock<std::mutex> poolLock(s_poolMutex);
+    if (count > s_bufferCount)
+    {
+        LOG_ERROR("Asked for %lu buffers from a pool of %lu.",
+                  static_cast<unsigned long>(count),
+                  static_cast<unsigned long>(s_bufferCount));
+        return false;
+    }
+
+    s_releaseCondition.wait(poolLock, [count]() { return s_freeBuffers.size() >= count; });
+    for (size_t i = 0; i < count; i++)
+    {
+        buffersOut[i] = s_freeBuffers.back();
+        s_freeBuffers.pop_back();
+    }
+    return true;
+}
+
+void bufferPool::release(unsigned char *const *buffers, size_t count)
+{
+    {
+        std::lock_guard<std::mutex> poolLock(s_poolMutex);
+        for (size_t i = 0; i < count; i++)
+        {
+            s_freeBuffers.push_back(buffers[i]);
+        }
+    }
+    s_releaseCondition.notify_all();
+}
@@ -0,0 +1,346 @@
+#include "copyEngine.hpp"
+#include "bufferPool.hpp"
+#include "console.hpp"
+#include "ioTuner.hpp"
+#include "logger.hpp"
+#include "progress.hpp"
+#include "scheduler.hpp"
+#include "strings.hpp"
+#include "trace.hpp"
+#include <cstring>
+
+CopyEngine::CopyEngine(TransferSink &sink, size_t engineCount, size_t engineIndex) : m_sink(sink), m_engineIndex(engineIndex)
+{
+    // Whatever the tuner picked, as long as the queues and this engine's share of the pool can hold it. startDump carves the pool to the
+    // tuned slot size, so this only comes up short if something else changed it.
+    size_t poolShare = bufferPool::getBufferCount() / (engineCount > 0 ? engineCount : 1);
+    m_slotSize = ioTuner::getSlotSize() > bufferPool::getBufferSize() ? bufferPool::getBufferSize() : ioTuner::getSlotSize();
+    m_slotCount = ioTuner::getSlotCount() > MAX_TRANSFER_SLOT_COUNT ? MAX_TRANSFER_SLOT_COUNT : ioTuner::getSlotCount();
+    m_slotCount = m_slotCount > poolShare ? poolShare : m_slotCount;
+    m_slotCount = m_slotCount < MIN_TRANSFER_SLOT_COUNT ? MIN_TRANSFER_SLOT_COUNT : m_slotCount;
+
+    // Borrow the slots' buffers and start them all out as free. This waits if other engines are still holding onto what this one needs.
+    // It never comes back with fewer than asked for, and the pool always has enough for MIN_TRANSFER_SLOT_COUNT, so the read thread
+    // can't end up waiting on a free queue that's empty forever.
+    static_assert(MIN_TRANSFER_SLOT_COUNT <= bufferPool::MIN_BUFFER_COUNT, "The pool has to be able to give every engine its minimum.");
+    unsigned char *buffers[MAX_TRANSFER_SLOT_COUNT] = {nullptr};
+    if (!bufferPool::acquire(buffers, m_slotCount))
+    {
+        // That can only be broken if the pool never got allocated. No threads means submit() fails every job instead of reading into
+        // nothing.
+        LOG_ERROR("Error acquiring %lu transfer buffers. The pool only has %lu.",
+                  static_cast<unsigned long>(m_slotCount),
+                  static_cast<unsigned long>(bufferPool::getBufferCount()));
+        Console::printf(strings::getByName(strings::names::NO_TRANSFER_BUFFERS));
+        m_slotCount = 0;
+        return;
+    }
+    for (size_t i = 0; i < m_slotCount; i++)
+    {
+        m_slots[i].buffer = buffers[i];
+        m_freeQueue.push(i);
+    }
+
+    m_readThread = std::thread(&CopyEngine::readThreadFunction, this);
+    m_hashThread = std::thread(&CopyEngine::hashThreadFunction, this);
+    m_writeThread = std::thread(&CopyEngine::writeThreadFunction, this);
+}
+
+CopyEngine::~CopyEngine()
+{
+    CopyEngine::finish();
+}
+
+void CopyEngine::submit(const fslib::Path &source, const fslib::Path &destination)
+{
+    if (!m_readThread.joinable())
+    {
+        LOG_ERROR("Can't copy \"%s\" without transfer buffers.", source.cString());
+        return;
+    }
+
+    std::shared_ptr<CopyJob> job = std::make_shared<CopyJob>();
+    job->source = source;
+    job->destination = destination;
+    {
+        std::unique_lock<std::mutex> jobLock(m_jobMutex);
+        m_queueCondition.wait(jobLock, [this]() { return m_jobQueue.size() < MAX_QUEUED_JOBS; });
+        m_jobQueue.push_back(std::move(job));
+    }
+    m_jobCondition.notify_one();
+}
+
+void CopyEngine::finish(void)
+{
+    // Already finished.
+    if (!m_readThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> jobLock(m_jobMutex);
+        m_noMoreJobs = true;
+    }
+    m_jobCondition.notify_one();
+
+    m_readThread.join();
+    m_hashThread.join();
+    m_writeThread.join();
+
+    // Everything's written, so the buffers can go to whoever's next.
+    unsigned char *buffers[MAX_TRANSFER_SLOT_COUNT] = {nullptr};
+    for (size_t i = 0; i < m_slotCount; i++)
+    {
+        buffers[i] = m_slots[i].buffer;
+        m_slots[i].buffer = nullptr;
+    }
+    bufferPool::release(buffers, m_slotCount);
+}
+
+void CopyEngine::readThreadFunction(void)
+{
+    TRACE_THREAD_NAME("copyRead");
+    scheduler::assignCurrentThread(scheduler::ROLE_READ, m_engineIndex);
+    while (true)
+    {
+        // Wait for a job or for finish() to tell us there aren't any more.
+        std::shared_ptr<CopyJob> job;
+        {
+            TRACE_SCOPE("waitForJob");
+            std::unique_lock<std::mutex> jobLock(m_jobMutex);
+            m_jobCondition.wait(jobLock, [this]() { return !m_jobQueue.empty() || m_noMoreJobs; });
+            if (m_jobQueue.empty())
+            {
+                break;
+            }
+            job = std::move(m_jobQueue.front());
+            m_jobQueue.pop_front();
+        }
+        m_queueCondition.notify_one();
+
+        fslib::File sourceFile;
+        {
+            TRACE_SCOPE("openSource");
+            sourceFile.open(job->source, FsOpenMode_Read);
+        }
+
+        if (!sourceFile.isOpen())
+        {
+            job->errorString = fslib::getErrorString();
+            LOG_ERROR("Error opening \"%s\" for reading: %s", job->source.cString(), job->errorString.c_str());
+            CopyEngine::sendEmptySlot(job, -1);
+            continue;
+        }
+
+        // Empty files still need a slot so the write thread creates them.
+        job->fileSize = sourceFile.getSize();
+        if (job->fileSize == 0)
+        {
+            CopyEngine::sendEmptySlot(job, 0);
+            continue;
+        }
+
+        for (int64_t i = 0; i < job->fileSize;)
+        {
+            // Grab a slot the write thread is finished with and read into it.
+            size_t slotIndex = CopyEngine::popSlot(m_freeQueue, "waitForFreeSlot");
+            TransferSlot &slot = m_slots[slotIndex];
+            ssize_t readSize = 0;
+            {
+                TRACE_SCOPE("readChunk");
+                readSize = sourceFile.read(slot.buffer, m_slotSize);
+            }
+            if (readSize <= 0)
+            {
+                // A read that comes up short is a failure too, or this would never end.
+                job->errorString = fslib::getErrorString();
+                LOG_ERROR("Error reading \"%s\": %s", job->source.cString(), job->errorString.c_str());
+                readSize = -1;
+            }
+            else
+            {
+                // Can't forget this or this will loop forever. Don't ask me how I know.
+                i += readSize;
+            }
+
+            slot.job = job;
+            slot.readSize = readSize;
+            slot.isLast = readSize < 0 || i >= job->fileSize;
+            m_filledQueue.push(slotIndex);
+
+            // The next file gets read right away whether the write thread has caught up or not.
+            if (readSize < 0)
+            {
+                break;
+            }
+        }
+    }
+    // Tell the other threads they can exit.
+    CopyEngine::sendEmptySlot(nullptr, 0);
+}
+
+void CopyEngine::hashThreadFunction(void)
+{
+    TRACE_THREAD_NAME("copyHash");
+    scheduler::assignCurrentThread(scheduler::ROLE_COMPUTE, m_engineIndex);
+    NcaVerifier verifier{};
+    uint32_t crc = 0;
+    std::shared_ptr<CopyJob> currentJob;
+    // Only stored ZIP entries need this. Deflated ones get theirs from ParallelDeflate.
+    bool needsCrc = m_sink.needsCrc();
+
+    while (true)
+    {
+        size_t slotIndex = CopyEngine::popSlot(m_filledQueue, "waitForFilledSlot");
+        TransferSlot &slot = m_slots[slotIndex];
+        if (!slot.job)
+        {
+            m_hashedQueue.push(slotIndex);
+            break;
+        }
+
+        if (slot.job != currentJob)
+        {
+            currentJob = slot.job;
+            verifier.begin();
+            crc = 0;
+        }
+
+        if (slot.readSize > 0)
+        {
+            TRACE_SCOPE("hashChunk");
+            verifier.update(slot.buffer, slot.readSize);
+            if (needsCrc)
+            {
+                crc = crc32CalculateWithSeed(crc, slot.buffer, slot.readSize);
+            }
+        }
+
+        // Anything that failed to read doesn't get a hash. The write thread will report the error instead.
+        if (slot.isLast && slot.readSize >= 0)
+        {
+            bool hashMatched = verifier.finish(currentJob->source.cString());
+            std::memcpy(currentJob->hash, verifier.getHash(), SHA256_HASH_SIZE);
+            currentJob->wasVerified = NcaVerifier::isVerifiable(currentJob->source.cString());
+            currentJob->hashMatched = currentJob->wasVerified && hashMatched;
+        }
+
+        if (slot.isLast)
+        {
+            // Short files still get a CRC of what was read. The ZIP entry needs to match what's actually in it.
+            currentJob->crc = crc;
+            currentJob.reset();
+        }
+        m_hashedQueue.push(slotIndex);
+    }
+}
+
+void CopyEngine::writeThreadFunction(void)
+{
+    // Job currently being written.
+    std::shared_ptr<CopyJob> currentJob;
+    // Whether the sink has the current job open.
+    bool jobStarted = false;
+    // Whether something went wrong with the current job and the rest of it should be skipped.
+    bool jobFailed = false;
+    TRACE_THREAD_NAME("copyWrite");
+    scheduler::assignCurrentThread(scheduler::ROLE_WRITE, m_engineIndex);
+
+    while (true)
+    {
+        size_t slotIndex = CopyEngine::popSlot(m_hashedQueue, "waitForHashedSlot");
+        TransferSlot &slot = m_slots[slotIndex];
+        std::shared_ptr<CopyJob> job = std::move(slot.job);
+        if (!job)
+        {
+            m_freeQueue.push(slotIndex);
+            break;
+        }
+
+        // First chunk of a new file.
+        if (job != currentJob)
+        {
+            TRACE_SCOPE("beginFile");
+            currentJob = job;
+            jobFailed = false;
+            jobStarted = slot.readSize >= 0 && m_sink.beginFile(job->source, job->destination, job->fileSize);
+            jobFailed = slot.readSize >= 0 && !jobStarted;
+        }
+
+        if (slot.readSize < 0 && !jobFailed)
+        {
+            // The sink never got to print the file's name if it failed right away.
+            if (jobStarted)
+            {
+                Console::printf("*%s*\n", job->errorString.c_str());
+            }
+            else
+            {
+                Console::printf("*%s: %s*\n", job->source.cString(), job->errorString.c_str());
+            }
+            jobFailed = true;
+        }
+        else if (slot.readSize > 0 && !jobFailed)
+        {
+            // Write it straight from the slot.
+            TRACE_SCOPE("writeChunk");
+            jobFailed = !m_sink.write(slot.buffer, slot.readSize);
+            // The bar only counts what actually made it to the SD.
+            if (!jobFailed)
+            {
+                Progress::addBytes(slot.readSize);
+            }
+        }
+
+        if (slot.isLast)
+        {
+            if (job->wasVerified)
+            {
+                Progress::addVerifiedNca(job->hashMatched);
+            }
+            bool hashFailed = job->wasVerified && !job->hashMatched;
+
+            // Sinks always get to close what they opened, even if it's short. ZIPs need that to stay valid.
+            TRACE_SCOPE("endFile");
+            if (jobStarted && !m_sink.endFile(job->crc, job->hash, !jobFailed && !hashFailed))
+            {
+                jobFailed = true;
+            }
+            jobStarted = false;
+            currentJob.reset();
+
+            if (hashFailed)
+            {
+                LOG_WARNING("SHA-256 of \"%s\" does not match its name!", job->source.cString());
+                Console::printf(strings::getByName(strings::names::HASH_MISMATCH));
+            }
+            else if (!jobFailed)
+            {
+                // Print that you won the game.
+                LOG_DEBUG("Copied \"%s\".", job->source.cString());
+                Console::printf(strings::getByName(strings::names::DONE));
+            }
+        }
+
+        // Give the slot back.
+        m_freeQueue.push(slotIndex);
+    }
+}
+
+void CopyEngine::sendEmptySlot(std::shared_ptr<CopyJob> job, ssize_t readSize)
+{
+    size_t slotIndex = m_freeQueue.pop();
+    TransferSlot &slot = m_slots[slotIndex];
+    slot.job = std::move(job);
+    slot.readSize = readSize;
+    slot.isLast = true;
+    m_filledQueue.push(slotIndex);
+}
+
+size_t CopyEngine::popSlot(SlotQueue &queue, const char *traceName)
+{
+    // This is where the stages wait on each other, so it's worth seeing in a trace.
+    TRACE_SCOPE(traceName);
+    return queue.pop();
+}
@@ -1,135 +1,190 @@
 #include "io.hpp"
+#include "copyEngine.hpp"
 #include "console.hpp"
 #include "logger.hpp"
 #include "strings.hpp"
-#include <condition_variable>
+#include "workStealingDeque.hpp"
 #include <memory>
-#include <mutex>
+#include <switch.h>
 #include <thread>
+#include <vector>
 
 namespace
 {
-    constexpr size_t FILE_BUFFER_SIZE = 0x600000;
-}
+    // A file to copy.
+    struct CopyTask
+    {
+            fslib::Path source;
+            fslib::Path destination;
+    };
 
-// To do: Just have a single thread that uses std::apply with a tuple to stop spawning and joining threads.
-void readThreadFunction(fslib::File &inputFile,
-                        std::mutex &bufferMutex,
-                        std::condition_variable &bufferCondition,
-                        bool &bufferIsReady,
-                        std::shared_ptr<unsigned char[]> sharedBuffer,
-                        uint32_t &readSize)
-{
-    int64_t fileSize = inputFile.getSize();
-    for (int64_t i = 0; i < fileSize;)
+    // One deque per worker.
+    using TaskDeques = std::vector<std::unique_ptr<WorkStealingDeque<CopyTask>>>;
+
+    // Writes each file to its destination and records it in the manifest file once it's all there.
+    class FolderSink : public TransferSink
     {
-        // This thread will spawn before the other thread writes.
-        // Read into sharedBuffer
-        readSize = inputFile.read(sharedBuffer.get(), FILE_BUFFER_SIZE);
+        public:
+            FolderSink(ManifestFile *manifestFile) : m_manifestFile(manifestFile) {};
+
+            bool beginFile(const fslib::Path &source, const fslib::Path &destination, int64_t fileSize) override
+            {
+                Console::printf(strings::getByName(strings::names::COPYING_FILE), source.cString());
+
+                m_destination = destination;
+                m_fileSize = fileSize;
+                m_destinationFile = std::make_unique<fslib::File>(destination, FsOpenMode_Create | FsOpenMode_Write, fileSize);
+                if (!m_destinationFile->isOpen())
+                {
+                    LOG_ERROR("Error opening \"%s\" for writing: %s", destination.cString(), fslib::getErrorString());
+                    Console::printf("*%s*\n", fslib::getErrorString());
+                    m_destinationFile.reset();
+                    return false;
+                }
+                return true;
+            }
+
+            bool write(const unsigned char *data, size_t dataSize) override
+            {
+                if (m_destinationFile->write(data, dataSize) != static_cast<ssize_t>(dataSize))
+                {
+                    LOG_ERROR("Error writing \"%s\": %s", m_destination.cString(), fslib::getErrorString());
+                    Console::printf("*%s*\n", fslib::getErrorString());
+                    return false;
+                }
+                return true;
+            }
+
+            bool endFile(uint32_t crc, const uint8_t *hash, bool isComplete) override
+            {
+                m_destinationFile.reset();
+                // Only files that made it all the way are recorded so the next run knows what it can skip.
+                if (isComplete && m_manifestFile)
+                {
+                    m_manifestFile->addFile(m_destination, m_fileSize, hash);
+                }
+                return true;
+            }
 
-        // Can't forget this or this will loop forever. Don't ask me how I know.
-        i += readSize;
+        private:
+            // Finished files are recorded here if it isn't nullptr.
+            ManifestFile *m_manifestFile = nullptr;
+            // File currently being written.
+            std::unique_ptr<fslib::File> m_destinationFile;
+            fslib::Path m_destination;
+            int64_t m_fileSize = 0;
+    };
+} // namespace
 
-        // Signal to other thread that read happened and stuff.
-        bufferIsReady = true;
-        bufferCondition.notify_one();
+// Each worker feeds its own engine. It works off the back of its own deque and steals from the front of the others once it runs dry.
+static void copyWorkerFunction(size_t workerIndex, TaskDeques &deques, ManifestFile *manifestFile)
+{
+    size_t workerCount = deques.size();
+    FolderSink sink(manifestFile);
+    CopyEngine engine(sink, workerCount, workerIndex);
 
-        // Wait for the other thread to copy the contents before reading again.
-        std::unique_lock<std::mutex> bufferLock(bufferMutex);
-        bufferCondition.wait(bufferLock, [&bufferIsReady]() { return bufferIsReady == false; });
-        // Mutex will release immediately. This works fine. I promise.
+    while (true)
+    {
+        CopyTask task;
+        bool gotTask = deques[workerIndex]->pop(task);
+        for (size_t i = 1; i < workerCount && !gotTask; i++)
+        {
+            gotTask = deques[(workerIndex + i) % workerCount]->steal(task);
+        }
+
+        // Nothing left anywhere. Everything is dealt out before the workers start, so nothing new is coming.
+        if (!gotTask)
+        {
+            break;
+        }
+
+        // This will block if the engine already has enough lined up, which is what leaves work for others to steal.
+        engine.submit(task.source, task.destination);
     }
+    engine.finish();
 }
 
-static void copyFile(const fslib::Path &source, const fslib::Path &destination)
+void copyManifest(const Manifest &manifest,
+                  const fslib::Path &source,
+                  const fslib::Path &destination,
+                  size_t pipelineCount,
+                  ManifestFile *manifestFile)
 {
-    fslib::File sourceFile(source, FsOpenMode_Read);
-    fslib::File destinationFile(destination, FsOpenMode_Create | FsOpenMode_Write, sourceFile.getSize());
-    if (!sourceFile.isOpen() || !destinationFile.isOpen())
+    // Directories come before anything in them, so they can just be created in order. Resumed dumps will already have most of them.
+    for (const ManifestEntry &entry : manifest.getEntries())
     {
-        Console::printf("*%s*\n", fslib::getErrorString());
-        return;
+        if (!entry.isDirectory)
+        {
+            continue;
+        }
+
+        fslib::Path directoryPath = destination / entry.path;
+        if (!fslib::directoryExists(directoryPath) && !fslib::createDirectory(directoryPath))
+        {
+            LOG_ERROR("Error creating \"%s\": %s", entry.path.c_str(), fslib::getErrorString());
+        }
     }
-    // Print string to console.
-    Console::printf(strings::getByName(strings::names::COPYING_FILE), source.cString());
-
-    // Stuff for threaded copying.
-    bool bufferIsReady = false;
-    std::condition_variable bufferCondition;
-    std::mutex bufferMutex;
-    std::shared_ptr<unsigned char[]> sharedBuffer(new unsigned char[FILE_BUFFER_SIZE]);
-    uint32_t readSize = 0;
-
-    // This thread has its own local buffer to copy to so it doesn't hold up the read thread.
-    std::unique_ptr<unsigned char[]> localBuffer(new unsigned char[FILE_BUFFER_SIZE]);
-
-    // Grab source size.
-    size_t fileSize = sourceFile.getSize();
-
-    // Spawn read thread.
-    std::thread readThread(readThreadFunction,
-                           std::ref(sourceFile),
-                           std::ref(bufferMutex),
-                           std::ref(bufferCondition),
-                           std::ref(bufferIsReady),
-                           sharedBuffer,
-                           std::ref(readSize));
-
-    for (size_t i = 0; i < fileSize;)
+
+    std::vector<const ManifestEntry *> files = manifest.getFilesLargestFirst();
+    if (pipelineCount <= 1)
     {
-        // This thread needs this saved.
-        uint32_t readCount = 0;
-        // Wait for buffer signal.
+        // One engine for the whole tree. Its threads live until every file is written.
+        FolderSink sink(manifestFile);
+        CopyEngine engine(sink);
+        for (const ManifestEntry *file : files)
         {
-            // Scoped so this releases asap.
-            std::unique_lock<std::mutex> bufferLock(bufferMutex);
-            bufferCondition.wait(bufferLock, [&bufferIsReady]() { return bufferIsReady; });
+            engine.submit(source / file->path, destination / file->path);
+        }
+        engine.finish();
+        return;
+    }
 
-            // Grab read count and copy shared to local.
-            readCount = readSize;
-            std::memcpy(localBuffer.get(), sharedBuffer.get(), readCount);
+    TaskDeques deques;
+    for (size_t i = 0; i < pipelineCount; i++)
+    {
+        deques.push_back(std::make_unique<WorkStealingDeque<CopyTask>>());
+    }
 
-            // Signal other thread it's good to go.
-            bufferIsReady = false;
-            bufferCondition.notify_one();
-        }
-        // Write local to file.
-        destinationFile.write(localBuffer.get(), readCount);
-        // Update loop
-        i += readCount;
+    // Deal the files out round robin. Smallest go in first so each owner pops its largest off the back first and thieves take the small
+    // stuff from the front.
+    for (size_t i = files.size(); i-- > 0;)
+    {
+        deques[i % pipelineCount]->push({.source = source / files[i]->path, .destination = destination / files[i]->path});
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < pipelineCount; i++)
+    {
+        workers.emplace_back(copyWorkerFunction, i, std::ref(deques), manifestFile);
+    }
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
     }
-    // Join read thread.
-    readThread.join();
-    // Print that you won the game.
-    Console::printf(strings::getByName(strings::names::DONE));
 }
 
-void copyDirectory(const fslib::Path &source, const fslib::Path &destination)
+bool getSdmcFreeSpace(int64_t &freeSpaceOut)
 {
-    fslib::Directory sourceDir(source);
-    if (!sourceDir.isOpen())
+    // fslib doesn't expose this, so it's straight to the SD's filesystem for this one.
+    FsFileSystem sdmc;
+    if (R_FAILED(fsOpenSdCardFileSystem(&sdmc)))
     {
-        logger::log(fslib::getErrorString());
-        return;
+        return false;
     }
+    bool gotSpace = R_SUCCEEDED(fsFsGetFreeSpace(&sdmc, "/", &freeSpaceOut));
+    fsFsClose(&sdmc);
+    return gotSpace;
+}
 
-    for (int64_t i = 0; i < sourceDir.getCount(); i++)
+bool getSdmcTotalSpace(int64_t &totalSpaceOut)
+{
+    FsFileSystem sdmc;
+    if (R_FAILED(fsOpenSdCardFileSystem(&sdmc)))
     {
-        if (sourceDir.isDirectory(i))
-        {
-            fslib::Path newSource = source / sourceDir[i];
-            fslib::Path newDestination = destination / sourceDir[i];
-            if (!fslib::createDirectory(newDestination))
-            {
-                continue;
-            }
-            copyDirectory(newSource, newDestination);
-        }
-        else
-        {
-            fslib::Path fullSource = source / sourceDir[i];
-            fslib::Path fullDestination = destination / sourceDir[i];
-            copyFile(fullSource, fullDestination);
-        }
+        return false;
     }
+    bool gotSpace = R_SUCCEEDED(fsFsGetTotalSpace(&sdmc, "/", &totalSpaceOut));
+    fsFsClose(&sdmc);
+    return gotSpace;
 }
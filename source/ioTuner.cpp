@@ -0,0 +1,219 @@
+#include "ioTuner.hpp"
+#include "bufferPool.hpp"
+#include "io.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    // Slot sizes that get tried. Anything past 2MB just eats memory without the SD getting any faster.
+    constexpr size_t SLOT_SIZE_CANDIDATES[] = {0x40000, 0x80000, 0x100000, 0x180000, 0x200000};
+    // Bytes read and written for each candidate. Big enough to get past the SD's cache, small enough that nobody notices.
+    constexpr size_t PROBE_SIZE = 0x800000;
+    // Memory a single engine's slots are allowed. Smaller slots get more of them.
+    constexpr size_t SLOT_MEMORY_BUDGET = 0xC00000;
+    // One per stage plus one so the read thread never waits on the write thread to hand one back. CopyEngine can't take more than the max.
+    constexpr size_t MIN_SLOT_COUNT = 4;
+    constexpr size_t MAX_SLOT_COUNT = 16;
+    // Candidates within this much of the fastest count as just as fast. Smaller slots win ties.
+    constexpr double TIE_THRESHOLD = 0.95;
+
+    // What biggestDump used before there was any tuning. Used until tune() or load() says otherwise.
+    size_t s_slotSize = 0x180000;
+    size_t s_slotCount = 8;
+} // namespace
+
+// Returns the current time in seconds.
+static double getSeconds(void)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns how many slots of slotSize fit in the budget.
+static size_t getSlotCountForSize(size_t slotSize)
+{
+    size_t slotCount = SLOT_MEMORY_BUDGET / slotSize;
+    return slotCount < MIN_SLOT_COUNT ? MIN_SLOT_COUNT : (slotCount > MAX_SLOT_COUNT ? MAX_SLOT_COUNT : slotCount);
+}
+
+// Reads PROBE_SIZE bytes from files in chunkSize reads and returns how many bytes per second that took. Each call picks up where the last
+// one left off so nothing is read twice and the NAND doesn't get to cheat.
+static double probeRead(const std::vector<fslib::Path> &files, size_t &fileIndex, fslib::File &file, unsigned char *buffer, size_t chunkSize)
+{
+    size_t totalRead = 0;
+    double startTime = getSeconds();
+    while (totalRead < PROBE_SIZE && fileIndex < files.size())
+    {
+        if (!file.isOpen() && !file.open(files[fileIndex], FsOpenMode_Read))
+        {
+            ++fileIndex;
+            continue;
+        }
+
+        ssize_t readSize = file.read(buffer, chunkSize);
+        if (readSize <= 0)
+        {
+            // On to the next one.
+            file.close();
+            ++fileIndex;
+            continue;
+        }
+        totalRead += readSize;
+    }
+    double elapsed = getSeconds() - startTime;
+    return elapsed > 0.0 ? totalRead / elapsed : 0.0;
+}
+
+// Writes PROBE_SIZE bytes to probePath in chunkSize writes the same way the dump would and returns how many bytes per second that took.
+static double probeWrite(const char *probePath, const unsigned char *buffer, size_t chunkSize)
+{
+    double startTime = getSeconds();
+    {
+        fslib::File probeFile(probePath, FsOpenMode_Create | FsOpenMode_Write, PROBE_SIZE);
+        if (!probeFile.isOpen())
+        {
+            LOG_ERROR("Error opening I/O probe file: %s", fslib::getErrorString());
+            return 0.0;
+        }
+
+        for (size_t i = 0; i < PROBE_SIZE; i += chunkSize)
+        {
+            size_t writeSize = PROBE_SIZE - i < chunkSize ? PROBE_SIZE - i : chunkSize;
+            if (probeFile.write(buffer, writeSize) != static_cast<ssize_t>(writeSize))
+            {
+                return 0.0;
+            }
+        }
+        // It doesn't count until it's actually on the card.
+        probeFile.flush();
+    }
+    double elapsed = getSeconds() - startTime;
+    fslib::deleteFile(probePath);
+    return elapsed > 0.0 ? PROBE_SIZE / elapsed : 0.0;
+}
+
+bool ioTuner::load(const char *cachePath)
+{
+    fslib::File cacheFile(cachePath, FsOpenMode_Read);
+    if (!cacheFile.isOpen())
+    {
+        return false;
+    }
+
+    char cacheLine[0x80] = {0};
+    if (cacheFile.read(cacheLine, sizeof(cacheLine) - 1) <= 0)
+    {
+        return false;
+    }
+
+    // The SD's size is the closest thing to telling cards apart.
+    long long totalSpace = 0;
+    unsigned long slotSize = 0, slotCount = 0;
+    int64_t sdmcTotalSpace = 0;
+    if (std::sscanf(cacheLine, "%lld %lu %lu", &totalSpace, &slotSize, &slotCount) != 3 || !getSdmcTotalSpace(sdmcTotalSpace) ||
+        totalSpace != sdmcTotalSpace || slotSize == 0 || slotCount < MIN_SLOT_COUNT || slotCount > MAX_SLOT_COUNT)
+    {
+        return false;
+    }
+
+    s_slotSize = slotSize;
+    s_slotCount = slotCount;
+    return true;
+}
+
+void ioTuner::tune(const Manifest &manifest, const fslib::Path &source, const char *probePath)
+{
+    TRACE_SCOPE("ioTune");
+    // The biggest files are the ones that matter and the ones least likely to run out mid probe.
+    std::vector<fslib::Path> probeFiles;
+    for (const ManifestEntry *file : manifest.getFilesLargestFirst())
+    {
+        probeFiles.push_back(source / file->path);
+    }
+
+    // The probe borrows from the pool like everything else. Nothing else is running yet, so it can be carved to fit the biggest candidate
+    // and there's always one free.
+    constexpr size_t LARGEST_CANDIDATE = SLOT_SIZE_CANDIDATES[sizeof(SLOT_SIZE_CANDIDATES) / sizeof(size_t) - 1];
+    static_assert(LARGEST_CANDIDATE <= bufferPool::MAX_BUFFER_SIZE, "Slot size candidates can't be larger than the pool's buffers.");
+    unsigned char *probeBuffer = nullptr;
+    if (!bufferPool::setBufferSize(LARGEST_CANDIDATE) || !bufferPool::acquire(&probeBuffer, 1))
+    {
+        return;
+    }
+    fslib::File probeSource;
+    size_t fileIndex = 0;
+
+    // The dump can only go as fast as the slower of the two, so that's what each size is judged on.
+    std::vector<double> scores;
+    double bestScore = 0.0;
+    for (size_t candidate : SLOT_SIZE_CANDIDATES)
+    {
+        double readRate = probeRead(probeFiles, fileIndex, probeSource, probeBuffer, candidate);
+        double writeRate = probeWrite(probePath, probeBuffer, candidate);
+        // If the read probe ran out of files, the write probe alone is all there is to go on.
+        double score = readRate > 0.0 && readRate < writeRate ? readRate : writeRate;
+        LOG_INFO("I/O probe 0x%X: read %.2f MB/s, write %.2f MB/s.",
+                 static_cast<unsigned int>(candidate),
+                 readRate / 1048576.0,
+                 writeRate / 1048576.0);
+
+        scores.push_back(score);
+        bestScore = score > bestScore ? score : bestScore;
+    }
+    bufferPool::release(&probeBuffer, 1);
+
+    // Nothing worked, so stick with the defaults.
+    if (bestScore <= 0.0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < scores.size(); i++)
+    {
+        if (scores[i] >= bestScore * TIE_THRESHOLD)
+        {
+            s_slotSize = SLOT_SIZE_CANDIDATES[i];
+            s_slotCount = getSlotCountForSize(s_slotSize);
+            break;
+        }
+    }
+}
+
+bool ioTuner::save(const char *cachePath)
+{
+    int64_t sdmcTotalSpace = 0;
+    if (!getSdmcTotalSpace(sdmcTotalSpace))
+    {
+        return false;
+    }
+
+    fslib::File cacheFile(cachePath, FsOpenMode_Create | FsOpenMode_Write);
+    if (!cacheFile.isOpen())
+    {
+        LOG_ERROR("Error saving I/O tuning: %s", fslib::getErrorString());
+        return false;
+    }
+
+    char cacheLine[0x80] = {0};
+    std::snprintf(cacheLine,
+                  sizeof(cacheLine),
+                  "%lld %lu %lu\n",
+                  static_cast<long long>(sdmcTotalSpace),
+                  static_cast<unsigned long>(s_slotSize),
+                  static_cast<unsigned long>(s_slotCount));
+    cacheFile << cacheLine;
+    return cacheFile.flush();
+}
+
+size_t ioTuner::getSlotSize(void)
+{
+    return s_slotSize;
+}
+
+size_t ioTuner::getSlotCount(void)
+{
+    return s_slotCount;
+}
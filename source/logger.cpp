@@ -1,30 +1,233 @@
 #include "logger.hpp"
 #include "fslib.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <switch.h>
+#include <thread>
 
 namespace
 {
-    // Size for formatted strings.
-    constexpr size_t VA_BUFFER_SIZE = 0x1000;
     // Path for the log file.
     const char *LOG_FILE_PATH = "sdmc:/switch/biggestDump.log";
+    // Max length of a single line. Anything longer is cut off. Has to fit a full path plus an error string.
+    constexpr size_t RECORD_SIZE = 0x400;
+    // Lines the ring holds before log() has to wait on the flusher. Must be a power of two.
+    constexpr size_t RECORD_COUNT = 128;
+    // Lines are gathered up to this much before they're written.
+    constexpr size_t WRITE_BUFFER_SIZE = 0x10000;
+    // How long the flusher sleeps between batches unless something wakes it up early.
+    constexpr std::chrono::milliseconds FLUSH_INTERVAL(250);
+    // How long the crash handler waits on the flusher to finish a batch before giving up on it.
+    constexpr int CRASH_FLUSH_ATTEMPTS = 100;
+    // What's written in front of each line for each level.
+    const char *LEVEL_NAMES[] = {"DEBUG", "INFO", "WARNING", "ERROR"};
+
+    // A single line. sequence says whose turn it is: it equals the slot's position while it's free, position + 1 once it's been written.
+    struct LogRecord
+    {
+            std::atomic<size_t> sequence;
+            size_t length;
+            char text[RECORD_SIZE];
+    };
+
+    // The ring. Any thread can claim a slot, only whoever holds s_consumerMutex can empty one.
+    std::unique_ptr<LogRecord[]> s_records;
+    alignas(64) std::atomic<size_t> s_head = 0;
+    alignas(64) std::atomic<size_t> s_tail = 0;
+
+    // Only ever touched by whoever holds s_consumerMutex.
+    std::mutex s_consumerMutex;
+    fslib::File s_logFile;
+    std::unique_ptr<char[]> s_writeBuffer;
+
+    // Flusher thread and what wakes it up.
+    std::thread s_flushThread;
+    std::mutex s_flushMutex;
+    std::condition_variable s_flushCondition;
+    std::atomic<bool> s_isRunning = false;
+    // Time lines are stamped relative to.
+    std::chrono::steady_clock::time_point s_startTime;
 } // namespace
 
+// libnx runs __libnx_exception_handler on this stack when something crashes.
+extern "C"
+{
+    alignas(16) u8 __nx_exception_stack[0x4000];
+    u64 __nx_exception_stack_size = sizeof(__nx_exception_stack);
+}
+
+// Writes everything in the ring to the log. Caller must hold s_consumerMutex.
+static void drainRecords(void)
+{
+    size_t bufferOffset = 0;
+    size_t head = s_head.load(std::memory_order_relaxed);
+    while (true)
+    {
+        LogRecord &record = s_records[head & (RECORD_COUNT - 1)];
+        if (record.sequence.load(std::memory_order_acquire) != head + 1)
+        {
+            break;
+        }
+
+        if (bufferOffset + record.length > WRITE_BUFFER_SIZE)
+        {
+            s_logFile.write(s_writeBuffer.get(), bufferOffset);
+            bufferOffset = 0;
+        }
+        std::memcpy(&s_writeBuffer[bufferOffset], record.text, record.length);
+        bufferOffset += record.length;
+
+        // Hand the slot back for the next time around the ring.
+        record.sequence.store(head + RECORD_COUNT, std::memory_order_release);
+        s_head.store(++head, std::memory_order_relaxed);
+    }
+
+    if (bufferOffset > 0)
+    {
+        s_logFile.write(s_writeBuffer.get(), bufferOffset);
+        s_logFile.flush();
+    }
+}
+
+// Wakes the flusher up before its interval is up.
+static void wakeFlusher(void)
+{
+    std::lock_guard<std::mutex> flushLock(s_flushMutex);
+    s_flushCondition.notify_one();
+}
+
+static void flushThreadFunction(void)
+{
+    while (s_isRunning.load(std::memory_order_acquire))
+    {
+        {
+            std::unique_lock<std::mutex> flushLock(s_flushMutex);
+            s_flushCondition.wait_for(flushLock, FLUSH_INTERVAL);
+        }
+        logger::flush();
+    }
+}
+
 void logger::initialize(void)
 {
-    fslib::File logFile(LOG_FILE_PATH, FsOpenMode_Create);
+    s_records = std::make_unique<LogRecord[]>(RECORD_COUNT);
+    for (size_t i = 0; i < RECORD_COUNT; i++)
+    {
+        s_records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    s_head = 0;
+    s_tail = 0;
+    s_writeBuffer = std::make_unique<char[]>(WRITE_BUFFER_SIZE);
+    s_startTime = std::chrono::steady_clock::now();
+
+    // This will create a blank log to start. It stays open until exit().
+    {
+        fslib::File logFile(LOG_FILE_PATH, FsOpenMode_Create);
+    }
+    s_logFile.open(LOG_FILE_PATH, FsOpenMode_Append);
+
+    s_isRunning = true;
+    s_flushThread = std::thread(flushThreadFunction);
 }
 
-void logger::log(const char *format, ...)
+void logger::exit(void)
 {
-    char vaBuffer[VA_BUFFER_SIZE] = {0};
+    if (!s_isRunning.exchange(false))
+    {
+        return;
+    }
+    wakeFlusher();
+    s_flushThread.join();
+
+    // Anything that snuck in after the flusher's last batch.
+    std::lock_guard<std::mutex> consumerLock(s_consumerMutex);
+    drainRecords();
+    s_logFile.close();
+}
+
+void logger::flush(void)
+{
+    std::lock_guard<std::mutex> consumerLock(s_consumerMutex);
+    drainRecords();
+}
+
+void logger::log(logger::Level level, const char *format, ...)
+{
+    if (!s_isRunning.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    // Claim the next free slot. If the ring is full, poke the flusher and wait for it to catch up.
+    LogRecord *record = nullptr;
+    size_t tail = s_tail.load(std::memory_order_relaxed);
+    while (!record)
+    {
+        LogRecord &candidate = s_records[tail & (RECORD_COUNT - 1)];
+        size_t sequence = candidate.sequence.load(std::memory_order_acquire);
+        if (sequence == tail && s_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+        {
+            record = &candidate;
+        }
+        else if (sequence < tail)
+        {
+            wakeFlusher();
+            std::this_thread::yield();
+            tail = s_tail.load(std::memory_order_relaxed);
+        }
+        else if (sequence != tail)
+        {
+            // Someone else got it first.
+            tail = s_tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_startTime).count();
+    int prefixLength = std::snprintf(record->text, RECORD_SIZE, "[%10.3f] %s: ", elapsed, LEVEL_NAMES[level]);
 
     std::va_list vaList;
     va_start(vaList, format);
-    vsnprintf(vaBuffer, VA_BUFFER_SIZE, format, vaList);
+    int textLength = std::vsnprintf(&record->text[prefixLength], RECORD_SIZE - prefixLength, format, vaList);
     va_end(vaList);
 
-    fslib::File logFile(LOG_FILE_PATH, FsOpenMode_Append);
-    logFile << vaBuffer << "\n";
-    logFile.flush();
+    // vsnprintf says how long it would have been, not how long it is. Cut off lines still get their newline.
+    size_t length = prefixLength + (textLength < 0 ? 0 : textLength);
+    length = length > RECORD_SIZE - 2 ? RECORD_SIZE - 2 : length;
+    record->text[length++] = '\n';
+    record->length = length;
+    record->sequence.store(tail + 1, std::memory_order_release);
+
+    // Errors are what someone's going to go looking for, so they don't wait for the interval.
+    if (level == logger::LEVEL_ERROR)
+    {
+        wakeFlusher();
+    }
+}
+
+// Called by libnx on the crashing thread. Gets what's in the ring onto the SD before the crash screen takes over.
+extern "C" void __libnx_exception_handler(ThreadExceptionDump *context)
+{
+    LOG_ERROR("Crashed! Error 0x%X at PC 0x%llX, FAR 0x%llX.",
+              context->error_desc,
+              static_cast<unsigned long long>(context->pc.x),
+              static_cast<unsigned long long>(context->far.x));
+
+    // The flusher might be in the middle of a batch. It won't be for long.
+    for (int i = 0; i < CRASH_FLUSH_ATTEMPTS; i++)
+    {
+        if (s_consumerMutex.try_lock())
+        {
+            drainRecords();
+            s_logFile.flush();
+            s_consumerMutex.unlock();
+            return;
+        }
+        svcSleepThread(1000000);
+    }
 }
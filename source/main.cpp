@@ -1,4 +1,5 @@
 #include "biggestDump.hpp"
+#include "scheduler.hpp"
 #include <switch.h>
 
 int main(void)
@@ -8,6 +9,8 @@ int main(void)
     {
         biggestDump.update();
         biggestDump.render();
+        // This only waits while a dump is running.
+        scheduler::throttleFrame();
     }
     return 0;
 }
@@ -0,0 +1,96 @@
+#include "manifest.hpp"
+#include "trace.hpp"
+#include "treeWalker.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+bool Manifest::scan(const fslib::Path &root)
+{
+    TRACE_SCOPE("scanContents");
+    m_entries.clear();
+    m_totalSize = 0;
+    m_fileCount = 0;
+
+    // Every entry gets its own copy of its path. The record's is only good until this returns, and the dumps all want a std::string.
+    TreeWalker walker;
+    return walker.walk(root, [this](const TreeRecord &record) {
+        m_entries.push_back({.path = std::string(record.path, record.pathLength), .size = record.size, .isDirectory = record.isDirectory});
+        if (!record.isDirectory)
+        {
+            m_totalSize += record.size;
+            ++m_fileCount;
+        }
+    });
+}
+
+const std::vector<ManifestEntry> &Manifest::getEntries(void) const
+{
+    return m_entries;
+}
+
+std::vector<const ManifestEntry *> Manifest::getFilesLargestFirst(void) const
+{
+    std::vector<const ManifestEntry *> files;
+    files.reserve(m_fileCount);
+    for (const ManifestEntry &entry : m_entries)
+    {
+        if (!entry.isDirectory)
+        {
+            files.push_back(&entry);
+        }
+    }
+    // Stable so files the same size stay in the order they were found.
+    std::stable_sort(files.begin(), files.end(), [](const ManifestEntry *a, const ManifestEntry *b) { return a->size > b->size; });
+    return files;
+}
+
+size_t Manifest::removeFiles(const std::function<bool(const ManifestEntry &)> &predicate)
+{
+    size_t originalCount = m_entries.size();
+    auto newEnd = std::remove_if(m_entries.begin(), m_entries.end(), [&](const ManifestEntry &entry) {
+        if (entry.isDirectory || !predicate(entry))
+        {
+            return false;
+        }
+        m_totalSize -= entry.size;
+        --m_fileCount;
+        return true;
+    });
+    m_entries.erase(newEnd, m_entries.end());
+    return originalCount - m_entries.size();
+}
+
+size_t Manifest::removeEmptyDirectories(void)
+{
+    // Every directory a file is in, all the way up.
+    std::unordered_set<std::string> usedDirectories;
+    for (const ManifestEntry &entry : m_entries)
+    {
+        if (entry.isDirectory)
+        {
+            continue;
+        }
+
+        for (size_t slash = entry.path.find('/'); slash != entry.path.npos; slash = entry.path.find('/', slash + 1))
+        {
+            usedDirectories.insert(entry.path.substr(0, slash));
+        }
+    }
+
+    size_t originalCount = m_entries.size();
+    auto newEnd = std::remove_if(m_entries.begin(), m_entries.end(), [&](const ManifestEntry &entry) {
+        return entry.isDirectory && usedDirectories.find(entry.path) == usedDirectories.end();
+    });
+    m_entries.erase(newEnd, m_entries.end());
+    return originalCount - m_entries.size();
+}
+
+int64_t Manifest::getTotalSize(void) const
+{
+    return m_totalSize;
+}
+
+size_t Manifest::getFileCount(void) const
+{
+    return m_fileCount;
+}
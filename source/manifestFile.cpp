@@ -0,0 +1,162 @@
+#include "manifestFile.hpp"
+#include "hex.hpp"
+#include "logger.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    // Size of the buffer used to format lines. Paths in sys:/Contents are nowhere near this.
+    constexpr size_t LINE_BUFFER_SIZE = 0x400;
+} // namespace
+
+// Parses a single line into pathOut and entryOut. Returns false if the line is malformed.
+static bool parseLine(const char *line, std::string &pathOut, ManifestFileEntry &entryOut)
+{
+    char *sizeEnd = nullptr;
+    entryOut.size = std::strtoll(line, &sizeEnd, 10);
+    if (sizeEnd == line || *sizeEnd != '\t')
+    {
+        return false;
+    }
+
+    const char *hashString = sizeEnd + 1;
+    for (size_t i = 0; i < SHA256_HASH_SIZE; i++)
+    {
+        int high = hex::digitToInt(hashString[i * 2]);
+        int low = hex::digitToInt(hashString[i * 2 + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+        entryOut.hash[i] = (high << 4) | low;
+    }
+
+    const char *pathString = hashString + SHA256_HASH_SIZE * 2;
+    if (*pathString != '\t' || *(pathString + 1) == '\0')
+    {
+        return false;
+    }
+    pathOut = pathString + 1;
+    return true;
+}
+
+bool ManifestFile::load(const fslib::Path &path)
+{
+    fslib::File manifestFile(path, FsOpenMode_Read);
+    if (!manifestFile.isOpen())
+    {
+        return false;
+    }
+
+    // These are small, so it's easier to just read the whole thing.
+    int64_t fileSize = manifestFile.getSize();
+    std::unique_ptr<char[]> fileBuffer = std::make_unique<char[]>(fileSize + 1);
+    if (fileSize > 0 && manifestFile.read(fileBuffer.get(), fileSize) != fileSize)
+    {
+        LOG_ERROR("Error reading manifest \"%s\": %s", path.cString(), fslib::getErrorString());
+        return false;
+    }
+    fileBuffer[fileSize] = '\0';
+
+    char *line = fileBuffer.get();
+    while (line && *line != '\0')
+    {
+        // A line without a new line at the end was cut off, so it's skipped.
+        char *lineEnd = std::strchr(line, '\n');
+        if (!lineEnd)
+        {
+            break;
+        }
+        *lineEnd = '\0';
+
+        std::string entryPath;
+        ManifestFileEntry entry;
+        if (parseLine(line, entryPath, entry))
+        {
+            m_entries[entryPath] = entry;
+        }
+        line = lineEnd + 1;
+    }
+    return true;
+}
+
+const ManifestFileEntry *ManifestFile::find(const std::string &path) const
+{
+    auto findEntry = m_entries.find(path);
+    if (findEntry == m_entries.end())
+    {
+        return nullptr;
+    }
+    return &findEntry->second;
+}
+
+size_t ManifestFile::getCount(void) const
+{
+    return m_entries.size();
+}
+
+const std::unordered_map<std::string, ManifestFileEntry> &ManifestFile::getEntries(void) const
+{
+    return m_entries;
+}
+
+bool ManifestFile::create(const fslib::Path &path, const fslib::Path &root)
+{
+    m_root = root.cString();
+    m_file = std::make_unique<fslib::File>(path, FsOpenMode_Create | FsOpenMode_Write);
+    if (!m_file->isOpen())
+    {
+        LOG_ERROR("Error creating manifest \"%s\": %s", path.cString(), fslib::getErrorString());
+        m_file.reset();
+        return false;
+    }
+
+    for (auto &[entryPath, entry] : m_entries)
+    {
+        ManifestFile::writeEntry(entryPath, entry);
+    }
+    m_file->flush();
+    return true;
+}
+
+void ManifestFile::remove(const std::string &path)
+{
+    m_entries.erase(path);
+}
+
+void ManifestFile::addFile(const fslib::Path &destination, int64_t size, const uint8_t *hash)
+{
+    // Trim the root and the slash after it.
+    const char *destinationString = destination.cString();
+    if (std::strncmp(destinationString, m_root.c_str(), m_root.length()) != 0 || destinationString[m_root.length()] != '/')
+    {
+        return;
+    }
+    std::string path = &destinationString[m_root.length() + 1];
+
+    ManifestFileEntry entry = {.size = size};
+    std::memcpy(entry.hash, hash, SHA256_HASH_SIZE);
+
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+    m_entries[path] = entry;
+    if (m_file)
+    {
+        ManifestFile::writeEntry(path, entry);
+        // Flushed every time so an interrupted dump still has everything that finished.
+        m_file->flush();
+    }
+}
+
+void ManifestFile::writeEntry(const std::string &path, const ManifestFileEntry &entry)
+{
+    char line[LINE_BUFFER_SIZE] = {0};
+    int lineLength = std::snprintf(line, LINE_BUFFER_SIZE, "%lld\t", static_cast<long long>(entry.size));
+    for (size_t i = 0; i < SHA256_HASH_SIZE; i++)
+    {
+        lineLength += std::snprintf(&line[lineLength], LINE_BUFFER_SIZE - lineLength, "%02x", entry.hash[i]);
+    }
+    std::snprintf(&line[lineLength], LINE_BUFFER_SIZE - lineLength, "\t%s\n", path.c_str());
+    *m_file << line;
+}
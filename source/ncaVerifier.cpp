@@ -0,0 +1,64 @@
+#include "ncaVerifier.hpp"
+#include "hex.hpp"
+#include <cstring>
+#include <strings.h>
+
+namespace
+{
+    // Content IDs are the first 16 bytes of the hash, so 32 hex digits.
+    constexpr size_t CONTENT_ID_SIZE = 0x10;
+    constexpr size_t CONTENT_ID_LENGTH = CONTENT_ID_SIZE * 2;
+} // namespace
+
+// Returns a pointer to the file name part of path.
+static const char *getFileName(const char *path)
+{
+    const char *lastSlash = std::strrchr(path, '/');
+    return lastSlash ? lastSlash + 1 : path;
+}
+
+bool NcaVerifier::isVerifiable(const char *path)
+{
+    const char *fileName = getFileName(path);
+    for (size_t i = 0; i < CONTENT_ID_LENGTH; i++)
+    {
+        if (hex::digitToInt(fileName[i]) < 0)
+        {
+            return false;
+        }
+    }
+    const char *extension = &fileName[CONTENT_ID_LENGTH];
+    return strcasecmp(extension, ".nca") == 0 || strcasecmp(extension, ".cnmt.nca") == 0;
+}
+
+void NcaVerifier::begin(void)
+{
+    sha256ContextCreate(&m_context);
+}
+
+void NcaVerifier::update(const void *data, size_t dataSize)
+{
+    sha256ContextUpdate(&m_context, data, dataSize);
+}
+
+bool NcaVerifier::finish(const char *path)
+{
+    sha256ContextGetHash(&m_context, m_hash);
+
+    const char *fileName = getFileName(path);
+    for (size_t i = 0; i < CONTENT_ID_SIZE; i++)
+    {
+        int high = hex::digitToInt(fileName[i * 2]);
+        int low = hex::digitToInt(fileName[i * 2 + 1]);
+        if (high < 0 || low < 0 || m_hash[i] != ((high << 4) | low))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const uint8_t *NcaVerifier::getHash(void) const
+{
+    return m_hash;
+}
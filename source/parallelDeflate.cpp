@@ -0,0 +1,297 @@
+#include "parallelDeflate.hpp"
+#include "logger.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+#include <cstring>
+
+ParallelDeflate::ParallelDeflate(int level, size_t threadCount) : m_level(level)
+{
+    m_dictionary = std::make_unique<unsigned char[]>(DICTIONARY_SIZE);
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        m_workers.emplace_back(&ParallelDeflate::workerFunction, this, i);
+    }
+
+    // Workers that couldn't initialize deflate just don't take blocks. As long as one made it, nothing changes but the speed.
+    std::unique_lock<std::mutex> blockLock(m_blockMutex);
+    m_doneCondition.wait(blockLock, [this, threadCount]() { return m_startedWorkers + m_failedWorkers == threadCount; });
+    if (m_startedWorkers > 0)
+    {
+        m_outputThread = std::thread(&ParallelDeflate::outputThreadFunction, this);
+        return;
+    }
+
+    LOG_WARNING("No deflate workers could start. Compressing on one thread.");
+    m_inlineStreamReady = deflateInit2(&m_inlineStream, m_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (!m_inlineStreamReady)
+    {
+        LOG_ERROR("Error initializing deflate.");
+    }
+}
+
+ParallelDeflate::~ParallelDeflate()
+{
+    {
+        std::lock_guard<std::mutex> blockLock(m_blockMutex);
+        m_exitThreads = true;
+    }
+    m_workCondition.notify_all();
+    m_doneCondition.notify_all();
+
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+    if (m_outputThread.joinable())
+    {
+        m_outputThread.join();
+    }
+
+    if (m_inlineStreamReady)
+    {
+        deflateEnd(&m_inlineStream);
+    }
+}
+
+void ParallelDeflate::begin(const OutputFunction &outputFunction)
+{
+    // Whatever's left of the last stream has to be out of the way first. It's only there if that stream failed partway.
+    std::unique_lock<std::mutex> blockLock(m_blockMutex);
+    m_doneCondition.wait(blockLock, [this]() { return m_blocks.empty(); });
+
+    m_outputFunction = outputFunction;
+    m_outputFailed = false;
+    m_dictionarySize = 0;
+    m_crc = crc32(0, Z_NULL, 0);
+    m_uncompressedSize = 0;
+    m_compressedSize = 0;
+}
+
+bool ParallelDeflate::compress(const unsigned char *data, size_t dataSize, bool isLast)
+{
+    TRACE_SCOPE("deflateQueue");
+    // Split data into blocks. An empty final call still needs one block to end the stream.
+    size_t blockCount = (dataSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (blockCount == 0 && !isLast)
+    {
+        return true;
+    }
+    else if (blockCount == 0)
+    {
+        blockCount = 1;
+    }
+
+    if (m_startedWorkers == 0)
+    {
+        // Same blocks, just compressed and output right here one at a time.
+        DeflateBlock block{};
+        bool blockFailed = !m_inlineStreamReady;
+        for (size_t i = 0; i < blockCount && !blockFailed; i++)
+        {
+            size_t offset = i * BLOCK_SIZE;
+            size_t inputSize = offset + BLOCK_SIZE > dataSize ? dataSize - offset : BLOCK_SIZE;
+            ParallelDeflate::fillBlock(block, data + offset, inputSize, isLast && i == blockCount - 1);
+            ParallelDeflate::compressBlock(m_inlineStream, block);
+            blockFailed = !ParallelDeflate::outputBlock(block);
+        }
+        return !blockFailed;
+    }
+
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        std::unique_ptr<DeflateBlock> block;
+        {
+            std::unique_lock<std::mutex> blockLock(m_blockMutex);
+            m_doneCondition.wait(blockLock, [this]() { return m_blocks.size() < MAX_PENDING_BLOCKS || m_outputFailed; });
+            if (m_outputFailed)
+            {
+                return false;
+            }
+
+            if (!m_spareBlocks.empty())
+            {
+                block = std::move(m_spareBlocks.back());
+                m_spareBlocks.pop_back();
+            }
+        }
+
+        // Copying is done outside the lock so the workers and the output thread don't have to wait on it.
+        if (!block)
+        {
+            block = std::make_unique<DeflateBlock>();
+        }
+        size_t offset = i * BLOCK_SIZE;
+        size_t inputSize = offset + BLOCK_SIZE > dataSize ? dataSize - offset : BLOCK_SIZE;
+        ParallelDeflate::fillBlock(*block, data + offset, inputSize, isLast && i == blockCount - 1);
+
+        {
+            std::lock_guard<std::mutex> blockLock(m_blockMutex);
+            m_blocks.push_back(std::move(block));
+        }
+        m_workCondition.notify_one();
+    }
+
+    // The end of the stream has to actually be out before whoever's writing it can close the entry.
+    std::unique_lock<std::mutex> blockLock(m_blockMutex);
+    if (isLast)
+    {
+        TRACE_SCOPE("deflateDrain");
+        m_doneCondition.wait(blockLock, [this]() { return m_blocks.empty(); });
+    }
+    return !m_outputFailed;
+}
+
+uint32_t ParallelDeflate::getCrc(void) const
+{
+    return m_crc;
+}
+
+uint64_t ParallelDeflate::getUncompressedSize(void) const
+{
+    return m_uncompressedSize;
+}
+
+uint64_t ParallelDeflate::getCompressedSize(void) const
+{
+    return m_compressedSize;
+}
+
+void ParallelDeflate::workerFunction(size_t workerIndex)
+{
+    TRACE_THREAD_NAME("deflateWorker");
+    scheduler::assignCurrentThread(scheduler::ROLE_COMPUTE, workerIndex);
+    // Each worker keeps its own stream so it only has to be reset between blocks.
+    z_stream stream{};
+    bool streamReady = deflateInit2(&stream, m_level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    {
+        std::lock_guard<std::mutex> blockLock(m_blockMutex);
+        ++(streamReady ? m_startedWorkers : m_failedWorkers);
+    }
+    m_doneCondition.notify_all();
+    if (!streamReady)
+    {
+        LOG_ERROR("Error initializing deflate for worker.");
+        return;
+    }
+
+    while (true)
+    {
+        DeflateBlock *block = nullptr;
+        {
+            std::unique_lock<std::mutex> blockLock(m_blockMutex);
+            m_workCondition.wait(blockLock, [this]() { return m_exitThreads || m_nextBlock < m_blocks.size(); });
+            if (m_exitThreads)
+            {
+                break;
+            }
+            block = m_blocks[m_nextBlock++].get();
+        }
+
+        ParallelDeflate::compressBlock(stream, *block);
+
+        {
+            std::lock_guard<std::mutex> blockLock(m_blockMutex);
+            block->isFinished = true;
+        }
+        m_doneCondition.notify_all();
+    }
+    deflateEnd(&stream);
+}
+
+void ParallelDeflate::outputThreadFunction(void)
+{
+    TRACE_THREAD_NAME("deflateOutput");
+    scheduler::assignCurrentThread(scheduler::ROLE_WRITE);
+    while (true)
+    {
+        DeflateBlock *block = nullptr;
+        bool outputFailed = false;
+        {
+            std::unique_lock<std::mutex> blockLock(m_blockMutex);
+            m_doneCondition.wait(blockLock, [this]() { return m_exitThreads || (!m_blocks.empty() && m_blocks.front()->isFinished); });
+            if (m_exitThreads)
+            {
+                break;
+            }
+            block = m_blocks.front().get();
+            outputFailed = m_outputFailed;
+        }
+
+        // Once something fails the rest of the stream is only dropped so begin() and compress() don't wait forever.
+        if (!outputFailed)
+        {
+            TRACE_SCOPE("deflateOutput");
+            outputFailed = !ParallelDeflate::outputBlock(*block);
+        }
+
+        {
+            std::lock_guard<std::mutex> blockLock(m_blockMutex);
+            m_outputFailed = outputFailed;
+            m_spareBlocks.push_back(std::move(m_blocks.front()));
+            m_blocks.pop_front();
+            --m_nextBlock;
+        }
+        m_doneCondition.notify_all();
+    }
+}
+
+void ParallelDeflate::fillBlock(DeflateBlock &block, const unsigned char *data, size_t dataSize, bool isLast)
+{
+    block.data.assign(m_dictionary.get(), m_dictionary.get() + m_dictionarySize);
+    block.data.insert(block.data.end(), data, data + dataSize);
+    block.dictionarySize = m_dictionarySize;
+    block.isLast = isLast;
+    block.failed = false;
+    block.isFinished = false;
+
+    // Whatever the block ends with is the next one's dictionary. That's the dictionary it started with too if this is a small one.
+    m_dictionarySize = block.data.size() > DICTIONARY_SIZE ? DICTIONARY_SIZE : block.data.size();
+    std::memcpy(m_dictionary.get(), block.data.data() + block.data.size() - m_dictionarySize, m_dictionarySize);
+}
+
+bool ParallelDeflate::outputBlock(const DeflateBlock &block)
+{
+    if (block.failed)
+    {
+        return false;
+    }
+
+    size_t inputSize = block.data.size() - block.dictionarySize;
+    m_crc = crc32_combine(m_crc, block.crc, inputSize);
+    m_uncompressedSize += inputSize;
+    m_compressedSize += block.output.size();
+    return block.output.empty() || m_outputFunction(block.output.data(), block.output.size());
+}
+
+void ParallelDeflate::compressBlock(z_stream &stream, DeflateBlock &block)
+{
+    TRACE_SCOPE("deflateBlock");
+    const unsigned char *input = block.data.data() + block.dictionarySize;
+    size_t inputSize = block.data.size() - block.dictionarySize;
+
+    deflateReset(&stream);
+    if (block.dictionarySize > 0 && deflateSetDictionary(&stream, block.data.data(), block.dictionarySize) != Z_OK)
+    {
+        block.failed = true;
+        return;
+    }
+
+    // This is the only time the block's CRC is worked out. The output thread just combines them in order.
+    block.crc = crc32(crc32(0, Z_NULL, 0), input, inputSize);
+
+    // Room for the worst case plus the sync marker Z_SYNC_FLUSH adds.
+    block.output.resize(deflateBound(&stream, inputSize) + 0x10);
+    stream.next_in = const_cast<Bytef *>(input);
+    stream.avail_in = inputSize;
+    stream.next_out = block.output.data();
+    stream.avail_out = block.output.size();
+
+    // Z_SYNC_FLUSH ends the block on a byte boundary without ending the stream so the next block can follow it directly.
+    int deflateError = deflate(&stream, block.isLast ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((block.isLast && deflateError != Z_STREAM_END) || (!block.isLast && deflateError != Z_OK) || stream.avail_in != 0)
+    {
+        block.failed = true;
+        return;
+    }
+    block.output.resize(block.output.size() - stream.avail_out);
+}
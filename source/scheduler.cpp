@@ -0,0 +1,116 @@
+#include "scheduler.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <switch.h>
+#include <thread>
+#ifndef __SWITCH__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+    // Applications get cores 0 through 2. 3 belongs to the system.
+    constexpr int APPLICATION_CORE_COUNT = 3;
+    constexpr uint32_t APPLICATION_CORE_MASK = (1 << APPLICATION_CORE_COUNT) - 1;
+    // Core each role's first thread starts on. The index passed to assignCurrentThread is added to this, so pipeline 0 reads on 1 and
+    // writes on 2, pipeline 1 reads on 2 and writes on 0, and so on. Compute threads start with the UI since it sleeps most of a dump.
+    constexpr int ROLE_FIRST_CORES[] = {0, 1, 2, 0};
+    // Priorities for each role. Lower is higher. 0x2C is what every thread starts with.
+    constexpr int ROLE_PRIORITIES[] = {0x2C, 0x2B, 0x2B, 0x2C};
+    // The UI only needs to keep up with the progress line while a dump is going.
+    constexpr std::chrono::milliseconds DUMP_FRAME_INTERVAL(66);
+
+    // Whether a dump is running.
+    std::atomic<bool> s_dumpIsActive = false;
+    // When the last throttled frame ended. Only the UI thread touches this.
+    std::chrono::steady_clock::time_point s_lastFrameTime;
+    // Where the UI thread was before the dump so it can be put back. Only the UI thread touches these too.
+    int32_t s_uiPreferredCore = 0;
+    uint64_t s_uiAffinityMask = 0;
+    int32_t s_uiPriority = 0;
+    bool s_uiWasSaved = false;
+} // namespace
+
+void scheduler::setDumpActive(bool isActive)
+{
+    s_dumpIsActive = isActive;
+    Handle currentThread = threadGetCurHandle();
+    if (isActive)
+    {
+        s_uiWasSaved = R_SUCCEEDED(svcGetThreadCoreMask(&s_uiPreferredCore, &s_uiAffinityMask, currentThread)) &&
+                       R_SUCCEEDED(svcGetThreadPriority(&s_uiPriority, currentThread));
+        scheduler::assignCurrentThread(scheduler::ROLE_UI);
+        s_lastFrameTime = std::chrono::steady_clock::now();
+    }
+    else if (s_uiWasSaved)
+    {
+        // Everything else the dump started is gone by now. Only the UI thread is left to put back.
+        if (R_FAILED(svcSetThreadCoreMask(currentThread, s_uiPreferredCore, static_cast<uint32_t>(s_uiAffinityMask))) ||
+            R_FAILED(svcSetThreadPriority(currentThread, s_uiPriority)))
+        {
+            LOG_WARNING("Error restoring UI thread to core %d.", s_uiPreferredCore);
+        }
+        s_uiWasSaved = false;
+    }
+}
+
+bool scheduler::isDumpActive(void)
+{
+    return s_dumpIsActive;
+}
+
+void scheduler::assignCurrentThread(scheduler::Role role, size_t index)
+{
+#ifndef BIGGESTDUMP_NO_SCHEDULING
+    // I/O threads are pinned so a pipeline's reads and writes never wait on each other for a core. Compute threads only prefer theirs
+    // and are free to move wherever there's room.
+    int core = (ROLE_FIRST_CORES[role] + index) % APPLICATION_CORE_COUNT;
+    uint32_t affinityMask = role == scheduler::ROLE_COMPUTE ? APPLICATION_CORE_MASK : 1 << core;
+#ifdef __SWITCH__
+    Handle currentThread = threadGetCurHandle();
+    if (R_FAILED(svcSetThreadCoreMask(currentThread, core, affinityMask)) ||
+        R_FAILED(svcSetThreadPriority(currentThread, ROLE_PRIORITIES[role])))
+    {
+        LOG_WARNING("Error assigning thread to core %d.", core);
+    }
+#else
+    // Same layout on the host so it can be timed against SCHEDULING=0. Priority needs root there, so only the cores are set. Hosts with
+    // fewer than three cores just get the layout wrapped around what they have.
+    unsigned int hostCoreCount = std::thread::hardware_concurrency();
+    hostCoreCount = hostCoreCount > 0 ? hostCoreCount : 1;
+    cpu_set_t coreSet;
+    CPU_ZERO(&coreSet);
+    for (int i = 0; i < APPLICATION_CORE_COUNT; i++)
+    {
+        if (affinityMask & (1 << i))
+        {
+            CPU_SET(i % hostCoreCount, &coreSet);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &coreSet) != 0)
+    {
+        LOG_WARNING("Error assigning thread to core %d.", core);
+    }
+#endif
+#endif
+}
+
+void scheduler::throttleFrame(void)
+{
+    if (!s_dumpIsActive)
+    {
+        return;
+    }
+
+    // sleep_until returns right away if the frame already took longer than the interval.
+    s_lastFrameTime += DUMP_FRAME_INTERVAL;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (s_lastFrameTime < now)
+    {
+        s_lastFrameTime = now;
+        return;
+    }
+    std::this_thread::sleep_until(s_lastFrameTime);
+}
@@ -0,0 +1,112 @@
+#include "systemScan.hpp"
+#include "fslib.hpp"
+#include "logger.hpp"
+#include "stopwatch.hpp"
+#include "trace.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    // What's scanned once the partition is mounted.
+    const char *CONTENTS_PATH = "sys:/Contents";
+
+    // Where the scan is at. Each one can only move forward.
+    enum ScanState
+    {
+        SCAN_NOT_STARTED,
+        SCAN_SCANNING,
+        SCAN_FINISHED
+    };
+
+    std::thread s_scanThread;
+    std::mutex s_scanMutex;
+    std::condition_variable s_scanCondition;
+    ScanState s_scanState = SCAN_NOT_STARTED;
+    // Written by mount() before the scan thread exists.
+    bool s_systemMounted = false;
+    // Results. Written by the scan thread before it moves the state past them.
+    std::string s_errorString;
+    bool s_contentsScanned = false;
+    Manifest s_manifest;
+} // namespace
+
+// Moves the state forward and wakes anyone waiting on it.
+static void setScanState(ScanState scanState)
+{
+    {
+        std::lock_guard<std::mutex> scanLock(s_scanMutex);
+        s_scanState = scanState;
+    }
+    s_scanCondition.notify_all();
+}
+
+// Waits until the scan is at least as far as scanState.
+static void waitForScanState(ScanState scanState)
+{
+    std::unique_lock<std::mutex> scanLock(s_scanMutex);
+    if (s_scanState == SCAN_NOT_STARTED)
+    {
+        return;
+    }
+    s_scanCondition.wait(scanLock, [scanState]() { return s_scanState >= scanState; });
+}
+
+static void scanThreadFunction(void)
+{
+    TRACE_THREAD_NAME("systemScan");
+
+    auto scanStart = stopwatch::start();
+    s_contentsScanned = s_manifest.scan(CONTENTS_PATH);
+    LOG_INFO("Startup: scanning %s took %.2f ms.", CONTENTS_PATH, stopwatch::getMillisecondsSince(scanStart));
+    setScanState(SCAN_FINISHED);
+}
+
+bool systemScan::mount(void)
+{
+    TRACE_SCOPE("mountSystem");
+    s_systemMounted = fslib::openBisFileSystem("sys", FsBisPartitionId_System);
+    if (!s_systemMounted)
+    {
+        // The log isn't up yet, so start() logs this.
+        s_errorString = fslib::getErrorString();
+    }
+    return s_systemMounted;
+}
+
+void systemScan::start(void)
+{
+    if (!s_systemMounted)
+    {
+        LOG_ERROR("Error mounting system partition: %s", s_errorString.c_str());
+        return;
+    }
+    s_scanState = SCAN_SCANNING;
+    s_scanThread = std::thread(scanThreadFunction);
+}
+
+bool systemScan::isMounted(std::string &errorStringOut)
+{
+    errorStringOut = s_errorString;
+    return s_systemMounted;
+}
+
+bool systemScan::getManifest(Manifest &manifestOut)
+{
+    waitForScanState(SCAN_FINISHED);
+    if (!s_contentsScanned)
+    {
+        return false;
+    }
+    manifestOut = s_manifest;
+    return true;
+}
+
+void systemScan::exit(void)
+{
+    if (s_scanThread.joinable())
+    {
+        s_scanThread.join();
+    }
+}
@@ -0,0 +1,100 @@
+#include "tar.hpp"
+#include "console.hpp"
+#include "copyEngine.hpp"
+#include "strings.hpp"
+#include "tarWriter.hpp"
+
+namespace
+{
+    // This is the error string so I don't actually have to type it over and over.
+    const char *ERROR_STRING_TEMPLATE = "\t\t\t*%s*\n";
+
+    // Writes each file as an entry in the tar.
+    class TarSink : public TransferSink
+    {
+        public:
+            TarSink(TarWriter &tar) : m_tar(tar) {};
+
+            bool beginFile(const fslib::Path &source, const fslib::Path &destination, int64_t fileSize) override
+            {
+                Console::printf(strings::getByName(strings::names::COPYING_FILE_TAR), source.cString());
+                // Tar headers need the size up front. The read thread already has it.
+                if (!m_tar.beginEntry(destination.getPath() + 1, fileSize))
+                {
+                    Console::printf(ERROR_STRING_TEMPLATE, "Error writing header to tar!");
+                    return false;
+                }
+                return true;
+            }
+
+            bool write(const unsigned char *data, size_t dataSize) override
+            {
+                if (!m_tar.write(data, dataSize))
+                {
+                    Console::printf(ERROR_STRING_TEMPLATE, "Error writing to file in tar.");
+                    return false;
+                }
+                return true;
+            }
+
+            bool endFile(uint32_t crc, const uint8_t *hash, bool isComplete) override
+            {
+                // Short files are padded out to what the header says so everything after them is still where it should be.
+                if (!m_tar.endEntry())
+                {
+                    Console::printf(ERROR_STRING_TEMPLATE, "Error writing to file in tar.");
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            TarWriter &m_tar;
+    };
+} // namespace
+
+void copyManifestToTar(const Manifest &manifest, const fslib::Path &directoryPath, const char *tarPath)
+{
+    // Same as the ZIP. Everything is known from the scan, so the tar can be allocated at exactly its size.
+    std::vector<const ManifestEntry *> files = manifest.getFilesLargestFirst();
+    int64_t tarSize = TarWriter::getEndRecordSize();
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        fslib::Path entryPath = directoryPath / entry.path;
+        tarSize += entry.isDirectory ? TarWriter::getDirectorySize(entryPath.getPath() + 1)
+                                     : TarWriter::getEntrySize(entryPath.getPath() + 1, entry.size);
+    }
+
+    TarWriter targetTar{};
+    if (!targetTar.open(tarPath, tarSize))
+    {
+        Console::printf("Error opening \"%s\" for writing!\n", tarPath);
+        return;
+    }
+
+    // Directories come first so extracting doesn't have to make them up.
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        fslib::Path directoryEntryPath = directoryPath / entry.path;
+        if (entry.isDirectory && !targetTar.addDirectory(directoryEntryPath.getPath() + 1))
+        {
+            Console::printf(ERROR_STRING_TEMPLATE, "Error writing directory to tar.");
+        }
+    }
+
+    {
+        TarSink sink(targetTar);
+        CopyEngine engine(sink);
+        for (const ManifestEntry *file : files)
+        {
+            fslib::Path filePath = directoryPath / file->path;
+            engine.submit(filePath, filePath);
+        }
+        engine.finish();
+    }
+
+    if (!targetTar.close())
+    {
+        Console::printf(ERROR_STRING_TEMPLATE, "Error writing end of tar.");
+    }
+}
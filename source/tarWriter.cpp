@@ -0,0 +1,235 @@
+#include "tarWriter.hpp"
+#include "logger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+namespace
+{
+    // Everything in a tar is in blocks of this.
+    constexpr int64_t BLOCK_SIZE = 512;
+    // Largest name and size a plain ustar header can hold. Anything past these gets a pax header.
+    constexpr size_t MAX_USTAR_NAME = 100;
+    constexpr int64_t MAX_USTAR_SIZE = 077777777777LL;
+    // Type flags.
+    constexpr char TYPE_FILE = '0';
+    constexpr char TYPE_DIRECTORY = '5';
+    constexpr char TYPE_PAX = 'x';
+    // Name given to pax headers. Readers that understand pax never extract these.
+    const char *PAX_HEADER_NAME = "PaxHeader";
+    // Zeros for padding. Short files might need a lot of it.
+    constexpr size_t ZERO_BUFFER_SIZE = 0x10000;
+    const uint8_t ZERO_BUFFER[ZERO_BUFFER_SIZE] = {0};
+
+    // The ustar header block.
+    struct UstarHeader
+    {
+            char name[100];
+            char mode[8];
+            char uid[8];
+            char gid[8];
+            char size[12];
+            char modificationTime[12];
+            char checksum[8];
+            char typeFlag;
+            char linkName[100];
+            char magic[6];
+            char version[2];
+            char userName[32];
+            char groupName[32];
+            char deviceMajor[8];
+            char deviceMinor[8];
+            char prefix[155];
+            char padding[12];
+    };
+    static_assert(sizeof(UstarHeader) == BLOCK_SIZE, "UstarHeader must be exactly one block.");
+} // namespace
+
+// Rounds size up to the next block.
+static inline int64_t alignToBlock(int64_t size)
+{
+    return (size + BLOCK_SIZE - 1) & ~(BLOCK_SIZE - 1);
+}
+
+// Writes value to field as zero padded octal with a NUL at the end. Returns false if value needs more digits than the field has.
+static bool writeOctal(char *field, size_t fieldSize, uint64_t value)
+{
+    // It's formatted here first so nothing ever gets cut off. 22 digits is enough for any 64 bit value.
+    char octal[24];
+    int length = std::snprintf(octal, sizeof(octal), "%0*llo", static_cast<int>(fieldSize - 1), static_cast<unsigned long long>(value));
+    if (length < 0 || static_cast<size_t>(length) >= fieldSize)
+    {
+        LOG_ERROR("0%llo doesn't fit in a %zu byte tar field.", static_cast<unsigned long long>(value), fieldSize);
+        return false;
+    }
+    std::memcpy(field, octal, length + 1);
+    return true;
+}
+
+// Appends a pax record to records. The length at the front counts itself, so it's figured out the annoying way.
+static void appendPaxRecord(std::string &records, const char *key, const std::string &value)
+{
+    size_t baseLength = std::strlen(key) + value.length() + 3;
+    size_t recordLength = baseLength + std::to_string(baseLength).length();
+    if (std::to_string(recordLength).length() != std::to_string(baseLength).length())
+    {
+        ++recordLength;
+    }
+    records += std::to_string(recordLength) + " " + key + "=" + value + "\n";
+}
+
+// Returns the pax records name and entrySize need. Empty if a ustar header is enough.
+static std::string getPaxRecords(const char *name, int64_t entrySize)
+{
+    std::string records;
+    if (std::strlen(name) > MAX_USTAR_NAME)
+    {
+        appendPaxRecord(records, "path", name);
+    }
+
+    if (entrySize > MAX_USTAR_SIZE)
+    {
+        appendPaxRecord(records, "size", std::to_string(entrySize));
+    }
+    return records;
+}
+
+// Returns the size of the headers name and entrySize need.
+static int64_t getHeaderSize(const char *name, int64_t entrySize)
+{
+    std::string paxRecords = getPaxRecords(name, entrySize);
+    return paxRecords.empty() ? BLOCK_SIZE : BLOCK_SIZE * 2 + alignToBlock(paxRecords.length());
+}
+
+bool TarWriter::open(const char *path, int64_t reserveSize)
+{
+    if (!m_file.open(path, reserveSize))
+    {
+        return false;
+    }
+    m_modificationTime = std::time(NULL);
+    return true;
+}
+
+bool TarWriter::addDirectory(const char *name)
+{
+    std::string directoryName = std::string(name) + "/";
+    return TarWriter::writeHeader(directoryName.c_str(), 0, TYPE_DIRECTORY);
+}
+
+bool TarWriter::beginEntry(const char *name, int64_t entrySize)
+{
+    m_entrySize = entrySize;
+    m_entryWritten = 0;
+    return TarWriter::writeHeader(name, entrySize, TYPE_FILE);
+}
+
+bool TarWriter::write(const void *data, size_t dataSize)
+{
+    if (dataSize == 0)
+    {
+        return true;
+    }
+
+    // Writing past what the header says would wreck everything after it.
+    if (m_entryWritten + static_cast<int64_t>(dataSize) > m_entrySize)
+    {
+        LOG_ERROR("Tar entry is larger than its header says!");
+        return false;
+    }
+    m_entryWritten += dataSize;
+    return m_file.write(data, dataSize);
+}
+
+bool TarWriter::endEntry(void)
+{
+    // Whatever wasn't written plus the padding to the end of the block.
+    return TarWriter::writeZeros(alignToBlock(m_entrySize) - m_entryWritten);
+}
+
+bool TarWriter::close(void)
+{
+    if (!m_file.isOpen())
+    {
+        return false;
+    }
+
+    bool closed = TarWriter::writeZeros(TarWriter::getEndRecordSize());
+    // The file still gets closed even if the end couldn't be written.
+    return m_file.close() && closed;
+}
+
+int64_t TarWriter::getEntrySize(const char *name, int64_t dataSize)
+{
+    return getHeaderSize(name, dataSize) + alignToBlock(dataSize);
+}
+
+int64_t TarWriter::getDirectorySize(const char *name)
+{
+    std::string directoryName = std::string(name) + "/";
+    return getHeaderSize(directoryName.c_str(), 0);
+}
+
+int64_t TarWriter::getEndRecordSize(void)
+{
+    return BLOCK_SIZE * 2;
+}
+
+bool TarWriter::writeHeader(const char *name, int64_t entrySize, char typeFlag)
+{
+    // The pax header goes first and applies to the header right after it.
+    std::string paxRecords = getPaxRecords(name, entrySize);
+    if (!paxRecords.empty() && (!TarWriter::writeHeader(PAX_HEADER_NAME, paxRecords.length(), TYPE_PAX) ||
+                                !m_file.write(paxRecords.data(), paxRecords.length()) ||
+                                !TarWriter::writeZeros(alignToBlock(paxRecords.length()) - paxRecords.length())))
+    {
+        return false;
+    }
+
+    UstarHeader header;
+    std::memset(&header, 0, sizeof(UstarHeader));
+    // If the name is too long, the pax path replaces whatever gets cut off here.
+    size_t nameLength = std::strlen(name);
+    std::memcpy(header.name, name, nameLength < sizeof(header.name) ? nameLength : sizeof(header.name));
+    if (!writeOctal(header.mode, sizeof(header.mode), typeFlag == TYPE_DIRECTORY ? 0755 : 0644) ||
+        !writeOctal(header.uid, sizeof(header.uid), 0) || !writeOctal(header.gid, sizeof(header.gid), 0) ||
+        !writeOctal(header.size, sizeof(header.size), entrySize > MAX_USTAR_SIZE ? 0 : entrySize) ||
+        !writeOctal(header.modificationTime, sizeof(header.modificationTime), m_modificationTime))
+    {
+        return false;
+    }
+    header.typeFlag = typeFlag;
+    std::memcpy(header.magic, "ustar", 6);
+    std::memcpy(header.version, "00", 2);
+
+    // Checksum is figured with its own field as spaces.
+    std::memset(header.checksum, ' ', sizeof(header.checksum));
+    const uint8_t *headerBytes = reinterpret_cast<const uint8_t *>(&header);
+    unsigned int checksum = 0;
+    for (int64_t i = 0; i < BLOCK_SIZE; i++)
+    {
+        checksum += headerBytes[i];
+    }
+    // Six digits and a NUL. The space after them stays. The biggest a checksum can be is 512 * 0xFF, which is six digits.
+    if (!writeOctal(header.checksum, sizeof(header.checksum) - 1, checksum))
+    {
+        return false;
+    }
+
+    return m_file.write(&header, sizeof(UstarHeader));
+}
+
+bool TarWriter::writeZeros(int64_t zeroSize)
+{
+    while (zeroSize > 0)
+    {
+        size_t writeSize = zeroSize > static_cast<int64_t>(ZERO_BUFFER_SIZE) ? ZERO_BUFFER_SIZE : zeroSize;
+        if (!m_file.write(ZERO_BUFFER, writeSize))
+        {
+            return false;
+        }
+        zeroSize -= writeSize;
+    }
+    return true;
+}
@@ -1,19 +1,533 @@
 #include "threadFunctions.hpp"
+#include "bufferPool.hpp"
 #include "console.hpp"
 #include "io.hpp"
+#include "ioTuner.hpp"
+#include "logger.hpp"
+#include "manifest.hpp"
+#include "manifestFile.hpp"
+#include "ncaVerifier.hpp"
+#include "progress.hpp"
 #include "strings.hpp"
+#include "systemScan.hpp"
+#include "tar.hpp"
+#include "trace.hpp"
+#include "updateMeta.hpp"
+#include "verify.hpp"
 #include "zip.hpp"
+#include <cctype>
+#include <cstdio>
+#include <unordered_map>
+#include <zlib.h>
+
+namespace
+{
+    // This is where everything is dumped from.
+    const char *CONTENTS_PATH = "sys:/Contents";
+    // Folder dump target and the manifest of what made it there.
+    const char *FIRMWARE_FOLDER = "sdmc:/FirmwareDump";
+    const char *FIRMWARE_MANIFEST = "sdmc:/FirmwareDump.manifest";
+    // ZIP dump target.
+    const char *FIRMWARE_ZIP = "sdmc:/FirmwareDump.zip";
+    // Tar dump target.
+    const char *FIRMWARE_TAR = "sdmc:/FirmwareDump.tar";
+    // Split ZIP volumes are named this + .partNN.zip.
+    const char *FIRMWARE_SPLIT_ZIP = "sdmc:/FirmwareDump";
+    // Largest file FAT32 can hold.
+    constexpr int64_t SPLIT_VOLUME_SIZE = 0xFFFFFFFF;
+    // Number of split volumes written at once.
+    constexpr size_t SPLIT_WRITER_COUNT = 2;
+    // Delta dump target, its manifest, and the list of files it left out because the last dump already has them.
+    const char *FIRMWARE_DELTA_FOLDER = "sdmc:/FirmwareDelta";
+    const char *FIRMWARE_DELTA_MANIFEST = "sdmc:/FirmwareDelta.manifest";
+    const char *FIRMWARE_DELTA_REFERENCES = "sdmc:/FirmwareDelta.references";
+    // Pending update dump target, its manifest, and the index of every NCA the update needs and where it ended up.
+    const char *PENDING_UPDATE_FOLDER = "sdmc:/PendingUpdate";
+    const char *PENDING_UPDATE_MANIFEST = "sdmc:/PendingUpdate.manifest";
+    const char *PENDING_UPDATE_INDEX = "sdmc:/PendingUpdate.index";
+    // Length of a content ID in hex digits. NCAs are named this and then .nca.
+    constexpr size_t CONTENT_ID_LENGTH = 32;
+    // Where the I/O tuning is saved and the scratch file used to measure it.
+    const char *TUNING_CACHE = "sdmc:/switch/biggestDump.tuning";
+    const char *TUNING_PROBE = "sdmc:/switch/biggestDump.probe";
+    // Every dump appends a line with how it went here. One JSON object per line so runs are easy to compare.
+    const char *STATS_PATH = "sdmc:/switch/biggestDump.stats";
+    // Number of files the folder dump copies at once. Each of these gets its own read/write pipeline.
+    constexpr size_t FOLDER_PIPELINE_COUNT = 2;
+    // Number of files read back at once when verifying. One per core.
+    constexpr size_t VERIFY_THREAD_COUNT = 3;
+    // Bytes in a MB for printing.
+    constexpr double BYTES_PER_MB = 1024.0 * 1024.0;
+} // namespace
+
+// Gets what's in CONTENTS_PATH into manifest and prints what was found. Returns false if it couldn't be scanned.
+static bool scanContents(Manifest &manifest)
+{
+    // This was already scanned at startup and can't change while biggestDump is running. Only scan it here if that didn't work.
+    if (!systemScan::getManifest(manifest))
+    {
+        Console::printf(strings::getByName(strings::names::SCANNING_CONTENTS), CONTENTS_PATH);
+        if (!manifest.scan(CONTENTS_PATH))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+            return false;
+        }
+        Console::printf(strings::getByName(strings::names::DONE));
+    }
+    Console::printf(strings::getByName(strings::names::SCAN_RESULT),
+                    static_cast<unsigned int>(manifest.getFileCount()),
+                    static_cast<double>(manifest.getTotalSize()) / BYTES_PER_MB);
+    return true;
+}
+
+// Makes sure what's in manifest will fit on the SD and starts the progress display. Returns false if the dump can't go on.
+static bool startDump(const Manifest &manifest)
+{
+    // If this fails, just go for it. Worst case is the same as before there was a check.
+    int64_t freeSpace = 0;
+    if (getSdmcFreeSpace(freeSpace) && freeSpace < manifest.getTotalSize())
+    {
+        Console::printf(strings::getByName(strings::names::NOT_ENOUGH_SPACE),
+                        static_cast<double>(manifest.getTotalSize()) / BYTES_PER_MB,
+                        static_cast<double>(freeSpace) / BYTES_PER_MB);
+        return false;
+    }
+
+    // Only the first dump with a new SD card has to sit through this.
+    if (!ioTuner::load(TUNING_CACHE))
+    {
+        Console::printf(strings::getByName(strings::names::TUNING_IO));
+        ioTuner::tune(manifest, CONTENTS_PATH, TUNING_PROBE);
+        ioTuner::save(TUNING_CACHE);
+        Console::printf(strings::getByName(strings::names::DONE));
+    }
+    Console::printf(strings::getByName(strings::names::TUNING_RESULT),
+                    static_cast<unsigned int>(ioTuner::getSlotCount()),
+                    static_cast<unsigned int>(ioTuner::getSlotSize() / 1024));
+    // Every buffer the engines borrow is exactly one slot.
+    if (!bufferPool::setBufferSize(ioTuner::getSlotSize()))
+    {
+        Console::printf(strings::getByName(strings::names::NO_TRANSFER_BUFFERS));
+        return false;
+    }
+
+    Progress::reset(manifest.getTotalSize());
+    return true;
+}
+
+// Appends how the dump of manifest went to STATS_PATH.
+static void writeRunStats(const char *modeName, const Manifest &manifest)
+{
+    double seconds = Progress::getElapsedSeconds();
+    double fileCount = static_cast<double>(manifest.getFileCount());
+    double totalSize = static_cast<double>(manifest.getTotalSize());
+
+    char statsLine[0x200] = {0};
+    std::snprintf(statsLine,
+                  sizeof(statsLine),
+                  "{\"mode\":\"%s\",\"files\":%u,\"bytes\":%lld,\"seconds\":%.3f,\"mbPerSecond\":%.2f,\"filesPerSecond\":%.2f,"
+                  "\"peakMemory\":%llu,\"slotSize\":%u,\"slotCount\":%u,\"verified\":%u,\"mismatches\":%u}\n",
+                  modeName,
+                  static_cast<unsigned int>(manifest.getFileCount()),
+                  static_cast<long long>(manifest.getTotalSize()),
+                  seconds,
+                  seconds > 0.0 ? totalSize / BYTES_PER_MB / seconds : 0.0,
+                  seconds > 0.0 ? fileCount / seconds : 0.0,
+                  static_cast<unsigned long long>(Progress::getPeakMemory()),
+                  static_cast<unsigned int>(ioTuner::getSlotSize()),
+                  static_cast<unsigned int>(ioTuner::getSlotCount()),
+                  static_cast<unsigned int>(Progress::getVerifiedCount()),
+                  static_cast<unsigned int>(Progress::getMismatchCount()));
+
+    fslib::File statsFile(STATS_PATH, fslib::fileExists(STATS_PATH) ? FsOpenMode_Append : FsOpenMode_Create | FsOpenMode_Write);
+    if (!statsFile.isOpen())
+    {
+        LOG_ERROR("Error opening stats file: %s", fslib::getErrorString());
+        return;
+    }
+    statsFile << statsLine;
+    statsFile.flush();
+}
+
+// Stops the progress clock, prints how verifying the NCAs went, and records the run. modeName is what the run is recorded as.
+static void finishDump(const char *modeName, const Manifest &manifest)
+{
+    Progress::finish();
+    Console::printf(strings::getByName(strings::names::VERIFY_RESULT),
+                    static_cast<unsigned int>(Progress::getVerifiedCount()),
+                    static_cast<unsigned int>(Progress::getMismatchCount()));
+    writeRunStats(modeName, manifest);
+    // Every thread that recorded anything is done by now.
+    TRACE_DUMP();
+}
+
+// Returns whether entry is recorded in manifestFile and the copy on the SD is still the right size. Stale records are dropped.
+static bool isAlreadyDumped(const ManifestEntry &entry, ManifestFile &manifestFile)
+{
+    const ManifestFileEntry *record = manifestFile.find(entry.path);
+    if (!record)
+    {
+        return false;
+    }
+
+    fslib::File dumpedFile(fslib::Path(FIRMWARE_FOLDER) / entry.path, FsOpenMode_Read);
+    if (record->size != entry.size || !dumpedFile.isOpen() || dumpedFile.getSize() != entry.size)
+    {
+        manifestFile.remove(entry.path);
+        return false;
+    }
+    return true;
+}
+
+// Returns the file name part of path.
+static std::string getFileName(const std::string &path)
+{
+    size_t lastSlash = path.find_last_of('/');
+    return lastSlash == path.npos ? path : path.substr(lastSlash + 1);
+}
+
+// Returns the part of path up to and including the NCA it belongs to, or an empty string if it isn't part of one. Big NCAs are stored
+// split as a <id>.nca directory of parts named 00, 01 and so on, so the NCA isn't always the file itself.
+static std::string getNcaPath(const std::string &path)
+{
+    for (size_t slash = path.find('/');; slash = path.find('/', slash + 1))
+    {
+        std::string ncaPath = path.substr(0, slash);
+        if (NcaVerifier::isVerifiable(ncaPath.c_str()))
+        {
+            return ncaPath;
+        }
+        else if (slash == path.npos)
+        {
+            return std::string();
+        }
+    }
+}
+
+// Returns the content ID the NCA at ncaPath is named after in lowercase, the same as updateMeta hands them out.
+static std::string getContentId(const std::string &ncaPath)
+{
+    std::string contentId = getFileName(ncaPath).substr(0, CONTENT_ID_LENGTH);
+    for (char &digit : contentId)
+    {
+        digit = std::tolower(static_cast<unsigned char>(digit));
+    }
+    return contentId;
+}
+
+// Writes one line per NCA the update needs to PENDING_UPDATE_INDEX with where it was found, or missing if it wasn't.
+static void writeUpdateIndex(uint32_t updateVersion,
+                             const std::vector<updateMeta::UpdateContent> &updateContents,
+                             const std::unordered_map<std::string, std::string> &contentPaths)
+{
+    fslib::File indexFile(PENDING_UPDATE_INDEX, FsOpenMode_Create | FsOpenMode_Write);
+    if (!indexFile.isOpen())
+    {
+        LOG_ERROR("Error opening update index: %s", fslib::getErrorString());
+        return;
+    }
+
+    char indexLine[0x200] = {0};
+    std::snprintf(indexLine,
+                  sizeof(indexLine),
+                  "# SystemUpdate %u.%u.%u v%u\n",
+                  updateVersion >> 26 & 0x3F,
+                  updateVersion >> 20 & 0x3F,
+                  updateVersion >> 16 & 0xF,
+                  updateVersion);
+    indexFile << indexLine;
+    for (const updateMeta::UpdateContent &content : updateContents)
+    {
+        const std::string &contentPath = contentPaths.at(content.contentId);
+        std::snprintf(indexLine,
+                      sizeof(indexLine),
+                      "%016llX %u %s %s.nca %s\n",
+                      static_cast<unsigned long long>(content.titleId),
+                      content.version,
+                      content.isMeta ? "meta" : "data",
+                      content.contentId.c_str(),
+                      contentPath.empty() ? "missing" : contentPath.c_str());
+        indexFile << indexLine;
+    }
+    indexFile.flush();
+}
 
 void thread::dumpToFolder(bool *isRunning)
 {
-    copyDirectory("sys:/Contents", "sdmc:/FirmwareDump");
+    Manifest manifest{};
+    if (scanContents(manifest) && startDump(manifest))
+    {
+        // Even a fresh dump gets a manifest so it can be resumed if it's interrupted.
+        ManifestFile manifestFile{};
+        manifestFile.create(FIRMWARE_MANIFEST, FIRMWARE_FOLDER);
+        copyManifest(manifest, CONTENTS_PATH, FIRMWARE_FOLDER, FOLDER_PIPELINE_COUNT, &manifestFile);
+        finishDump("folder", manifest);
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::resumeDumpToFolder(bool *isRunning)
+{
+    Manifest manifest{};
+    if (scanContents(manifest))
+    {
+        // No manifest just means everything gets copied.
+        ManifestFile manifestFile{};
+        manifestFile.load(FIRMWARE_MANIFEST);
+
+        size_t skippedCount = manifest.removeFiles([&manifestFile](const ManifestEntry &entry) { return isAlreadyDumped(entry, manifestFile); });
+        Console::printf(strings::getByName(strings::names::SKIPPING_EXISTING), static_cast<unsigned int>(skippedCount));
+
+        if (startDump(manifest))
+        {
+            manifestFile.create(FIRMWARE_MANIFEST, FIRMWARE_FOLDER);
+            copyManifest(manifest, CONTENTS_PATH, FIRMWARE_FOLDER, FOLDER_PIPELINE_COUNT, &manifestFile);
+            finishDump("resume", manifest);
+        }
+    }
     Console::printf(strings::getByName(strings::names::QUIT));
     *isRunning = false;
 }
 
 void thread::dumpToZip(bool *isRunning)
 {
-    copyDirectoryToZip("sys:/Contents", "sdmc:/FirmwareDump.zip");
+    Manifest manifest{};
+    if (scanContents(manifest) && startDump(manifest))
+    {
+        copyManifestToZip(manifest, CONTENTS_PATH, FIRMWARE_ZIP);
+        finishDump("zip", manifest);
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::dumpToCompressedZip(bool *isRunning)
+{
+    Manifest manifest{};
+    if (scanContents(manifest) && startDump(manifest))
+    {
+        copyManifestToZip(manifest, CONTENTS_PATH, FIRMWARE_ZIP, Z_DEFAULT_COMPRESSION);
+        finishDump("compressedZip", manifest);
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::dumpToTar(bool *isRunning)
+{
+    Manifest manifest{};
+    if (scanContents(manifest) && startDump(manifest))
+    {
+        copyManifestToTar(manifest, CONTENTS_PATH, FIRMWARE_TAR);
+        finishDump("tar", manifest);
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::dumpToSplitZip(bool *isRunning)
+{
+    Manifest manifest{};
+    if (scanContents(manifest) && startDump(manifest))
+    {
+        copyManifestToSplitZip(manifest, CONTENTS_PATH, FIRMWARE_SPLIT_ZIP, SPLIT_VOLUME_SIZE, SPLIT_WRITER_COUNT);
+        finishDump("splitZip", manifest);
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::dumpDeltaToFolder(bool *isRunning)
+{
+    // The folder dump's manifest is what this is a delta against.
+    ManifestFile baseManifest{};
+    Manifest manifest{};
+    if (!baseManifest.load(FIRMWARE_MANIFEST))
+    {
+        Console::printf(strings::getByName(strings::names::NO_BASE_MANIFEST), FIRMWARE_MANIFEST);
+    }
+    else if (scanContents(manifest))
+    {
+        // Content IDs are the first half of the NCA's hash, so the same name and size means the same NCA no matter where it was found.
+        // Anything that isn't named like that has to be copied, since there's no telling it changed without reading it.
+        std::unordered_map<std::string, const ManifestFileEntry *> contentIndex;
+        for (auto &[entryPath, entry] : baseManifest.getEntries())
+        {
+            if (NcaVerifier::isVerifiable(entryPath.c_str()))
+            {
+                contentIndex[getFileName(entryPath)] = &entry;
+            }
+        }
+
+        // Unchanged files get a line in the references instead of being copied.
+        ManifestFile referenceFile{};
+        referenceFile.create(FIRMWARE_DELTA_REFERENCES, FIRMWARE_DELTA_FOLDER);
+        size_t unchangedCount = manifest.removeFiles([&](const ManifestEntry &entry) {
+            if (!NcaVerifier::isVerifiable(entry.path.c_str()))
+            {
+                return false;
+            }
+
+            auto findContent = contentIndex.find(getFileName(entry.path));
+            if (findContent == contentIndex.end() || findContent->second->size != entry.size)
+            {
+                return false;
+            }
+            referenceFile.addFile(fslib::Path(FIRMWARE_DELTA_FOLDER) / entry.path, entry.size, findContent->second->hash);
+            return true;
+        });
+        Console::printf(strings::getByName(strings::names::DELTA_RESULT),
+                        static_cast<unsigned int>(unchangedCount),
+                        static_cast<unsigned int>(manifest.getFileCount()));
+
+        if (startDump(manifest))
+        {
+            ManifestFile deltaManifest{};
+            deltaManifest.create(FIRMWARE_DELTA_MANIFEST, FIRMWARE_DELTA_FOLDER);
+            copyManifest(manifest, CONTENTS_PATH, FIRMWARE_DELTA_FOLDER, FOLDER_PIPELINE_COUNT, &deltaManifest);
+            finishDump("delta", manifest);
+        }
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::verifyDump(bool *isRunning)
+{
+    // Reading back goes fastest in big chunks, whatever the tuner picked for dumping. The workers size everything off the pool, so if
+    // it can't be resized they just take more, smaller reads.
+    if (!bufferPool::setBufferSize(bufferPool::MAX_BUFFER_SIZE))
+    {
+        LOG_WARNING("Verifying with 0x%lX byte buffers instead.", static_cast<unsigned long>(bufferPool::getBufferSize()));
+    }
+
+    // Whichever dumps are there get checked. Both count towards the same report and the same progress bar, so it's only reset once here.
+    Progress::reset(0);
+    VerifyResult result{};
+    bool foundDump = false;
+    if (fslib::directoryExists(FIRMWARE_FOLDER))
+    {
+        foundDump = true;
+        Console::printf(strings::getByName(strings::names::VERIFYING), FIRMWARE_FOLDER);
+        if (!verifyFolder(FIRMWARE_FOLDER, FIRMWARE_MANIFEST, VERIFY_THREAD_COUNT, result))
+        {
+            Console::printf("*%s*\n", fslib::getErrorString());
+        }
+    }
+
+    if (fslib::fileExists(FIRMWARE_ZIP))
+    {
+        foundDump = true;
+        Console::printf(strings::getByName(strings::names::VERIFYING), FIRMWARE_ZIP);
+        if (!verifyZip(FIRMWARE_ZIP, VERIFY_THREAD_COUNT, result))
+        {
+            // A ZIP without a central directory can't be extracted, so the whole thing counts as one damaged file.
+            Console::printf(strings::getByName(strings::names::VERIFY_DAMAGED), FIRMWARE_ZIP);
+            ++result.checkedCount;
+            ++result.failedCount;
+        }
+    }
+
+    if (!foundDump)
+    {
+        Console::printf(strings::getByName(strings::names::NOTHING_TO_VERIFY));
+    }
+    else
+    {
+        Progress::finish();
+        Console::printf(strings::getByName(strings::names::VERIFY_RESULT),
+                        static_cast<unsigned int>(result.ncaCount),
+                        static_cast<unsigned int>(result.ncaMismatchCount));
+        if (result.failedCount == 0)
+        {
+            Console::printf(strings::getByName(strings::names::VERIFY_PASSED), static_cast<unsigned int>(result.checkedCount));
+        }
+        else
+        {
+            Console::printf(strings::getByName(strings::names::VERIFY_FAILED),
+                            static_cast<unsigned int>(result.failedCount),
+                            static_cast<unsigned int>(result.checkedCount));
+        }
+        LOG_INFO("Verified %u files in %.3f seconds, %u failed.",
+                 static_cast<unsigned int>(result.checkedCount),
+                 Progress::getElapsedSeconds(),
+                 static_cast<unsigned int>(result.failedCount));
+        TRACE_DUMP();
+    }
+    Console::printf(strings::getByName(strings::names::QUIT));
+    *isRunning = false;
+}
+
+void thread::dumpPendingUpdate(bool *isRunning)
+{
+    uint32_t updateVersion = 0;
+    bool isPending = false;
+    std::vector<updateMeta::UpdateContent> updateContents;
+    Manifest manifest{};
+    if (!updateMeta::getLatestSystemUpdate(updateVersion, isPending, updateContents))
+    {
+        Console::printf(strings::getByName(strings::names::UPDATE_META_ERROR));
+    }
+    else if (scanContents(manifest))
+    {
+        // Without a pending update the newest one is what's installed, which is still a complete set to hand to ChoiDujourNX.
+        Console::printf(strings::getByName(isPending ? strings::names::PENDING_UPDATE_FOUND : strings::names::NO_PENDING_UPDATE),
+                        static_cast<unsigned int>(updateVersion >> 26 & 0x3F),
+                        static_cast<unsigned int>(updateVersion >> 20 & 0x3F),
+                        static_cast<unsigned int>(updateVersion >> 16 & 0xF),
+                        static_cast<unsigned int>(updateContents.size()));
+
+        // Content ID -> where it is under CONTENTS_PATH. Paths are filled in as they're found.
+        std::unordered_map<std::string, std::string> contentPaths;
+        for (const updateMeta::UpdateContent &content : updateContents)
+        {
+            contentPaths[content.contentId];
+        }
+
+        // Everything the update doesn't reference stays where it is, along with the directories that end up empty.
+        manifest.removeFiles([&contentPaths](const ManifestEntry &entry) {
+            std::string ncaPath = getNcaPath(entry.path);
+            if (ncaPath.empty())
+            {
+                return true;
+            }
+
+            auto findContent = contentPaths.find(getContentId(ncaPath));
+            if (findContent == contentPaths.end())
+            {
+                return true;
+            }
+            // Every part of a split NCA points at the same directory.
+            findContent->second = ncaPath;
+            return false;
+        });
+        manifest.removeEmptyDirectories();
+
+        size_t missingCount = 0;
+        for (auto &[contentId, contentPath] : contentPaths)
+        {
+            if (contentPath.empty())
+            {
+                LOG_WARNING("Update content %s is not in %s.", contentId.c_str(), CONTENTS_PATH);
+                ++missingCount;
+            }
+        }
+
+        if (missingCount > 0)
+        {
+            Console::printf(strings::getByName(strings::names::UPDATE_CONTENT_MISSING), static_cast<unsigned int>(missingCount));
+        }
+        writeUpdateIndex(updateVersion, updateContents, contentPaths);
+
+        if (startDump(manifest))
+        {
+            ManifestFile updateManifest{};
+            updateManifest.create(PENDING_UPDATE_MANIFEST, PENDING_UPDATE_FOLDER);
+            copyManifest(manifest, CONTENTS_PATH, PENDING_UPDATE_FOLDER, FOLDER_PIPELINE_COUNT, &updateManifest);
+            finishDump("pendingUpdate", manifest);
+        }
+    }
     Console::printf(strings::getByName(strings::names::QUIT));
     *isRunning = false;
 }
@@ -0,0 +1,180 @@
+#include "trace.hpp"
+#ifdef BIGGESTDUMP_TRACE
+#include "fslib.hpp"
+#include "logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Events kept per thread. Once it's full, the oldest are overwritten. Must be a power of two.
+    constexpr size_t EVENTS_PER_THREAD = 0x4000;
+    // Where the trace is written. Right next to the log.
+    const char *TRACE_PATH = "sdmc:/switch/biggestDump.trace.json";
+    // JSON is built up to about this much before it's written.
+    constexpr size_t WRITE_BUFFER_SIZE = 0x10000;
+
+    // A single finished event.
+    struct TraceEvent
+    {
+            const char *name;
+            int64_t startTime;
+            int64_t endTime;
+    };
+
+    // Every thread that records anything gets one of these. Only its own thread writes to it.
+    struct ThreadBuffer
+    {
+            std::unique_ptr<TraceEvent[]> events;
+            uint64_t eventCount = 0;
+            const char *threadName = nullptr;
+            unsigned int threadId = 0;
+            // Set when the thread exits so dump() knows the buffer can go.
+            std::atomic<bool> threadExited = false;
+    };
+
+    // Marks its thread's buffer as finished when the thread exits.
+    struct ThreadHandle
+    {
+            ThreadBuffer *buffer = nullptr;
+            ~ThreadHandle()
+            {
+                if (buffer)
+                {
+                    buffer->threadExited = true;
+                }
+            }
+    };
+
+    // Every buffer handed out. The lock is only taken the first time a thread records something and when dumping.
+    std::mutex s_bufferMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+    unsigned int s_nextThreadId = 1;
+    // Calling thread's buffer.
+    thread_local ThreadHandle s_threadHandle;
+} // namespace
+
+// Returns the calling thread's buffer, creating it if this is the first time.
+static ThreadBuffer *getThreadBuffer(void)
+{
+    if (!s_threadHandle.buffer)
+    {
+        std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+        buffer->events = std::make_unique<TraceEvent[]>(EVENTS_PER_THREAD);
+
+        std::lock_guard<std::mutex> bufferLock(s_bufferMutex);
+        buffer->threadId = s_nextThreadId++;
+        s_threadHandle.buffer = buffer.get();
+        s_buffers.push_back(std::move(buffer));
+    }
+    return s_threadHandle.buffer;
+}
+
+// Writes jsonBuffer to traceFile and empties it.
+static void flushJson(fslib::File &traceFile, std::string &jsonBuffer)
+{
+    traceFile << jsonBuffer;
+    jsonBuffer.clear();
+}
+
+int64_t trace::getTimestamp(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void trace::record(const char *name, int64_t startTime, int64_t endTime)
+{
+    ThreadBuffer *buffer = getThreadBuffer();
+    buffer->events[buffer->eventCount++ & (EVENTS_PER_THREAD - 1)] = {.name = name, .startTime = startTime, .endTime = endTime};
+}
+
+void trace::setThreadName(const char *name)
+{
+    getThreadBuffer()->threadName = name;
+}
+
+void trace::dump(void)
+{
+    std::lock_guard<std::mutex> bufferLock(s_bufferMutex);
+
+    // Everything is relative to the first event so the numbers stay readable.
+    int64_t firstTime = INT64_MAX;
+    for (std::unique_ptr<ThreadBuffer> &buffer : s_buffers)
+    {
+        uint64_t firstEvent = buffer->eventCount > EVENTS_PER_THREAD ? buffer->eventCount - EVENTS_PER_THREAD : 0;
+        for (uint64_t i = firstEvent; i < buffer->eventCount; i++)
+        {
+            int64_t startTime = buffer->events[i & (EVENTS_PER_THREAD - 1)].startTime;
+            firstTime = startTime < firstTime ? startTime : firstTime;
+        }
+    }
+
+    fslib::File traceFile(TRACE_PATH, FsOpenMode_Create | FsOpenMode_Write);
+    if (!traceFile.isOpen())
+    {
+        LOG_ERROR("Error opening trace file: %s", fslib::getErrorString());
+        return;
+    }
+
+    std::string jsonBuffer = "{\"traceEvents\":[";
+    jsonBuffer.reserve(WRITE_BUFFER_SIZE + 0x200);
+    bool isFirstEvent = true;
+    char eventString[0x100] = {0};
+    for (std::unique_ptr<ThreadBuffer> &buffer : s_buffers)
+    {
+        if (buffer->threadName)
+        {
+            std::snprintf(eventString,
+                          sizeof(eventString),
+                          "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                          isFirstEvent ? "" : ",",
+                          buffer->threadId,
+                          buffer->threadName);
+            jsonBuffer += eventString;
+            isFirstEvent = false;
+        }
+
+        uint64_t firstEvent = buffer->eventCount > EVENTS_PER_THREAD ? buffer->eventCount - EVENTS_PER_THREAD : 0;
+        for (uint64_t i = firstEvent; i < buffer->eventCount; i++)
+        {
+            // Chrome wants microseconds.
+            const TraceEvent &event = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+            std::snprintf(eventString,
+                          sizeof(eventString),
+                          "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                          isFirstEvent ? "" : ",",
+                          event.name,
+                          buffer->threadId,
+                          static_cast<double>(event.startTime - firstTime) / 1000.0,
+                          static_cast<double>(event.endTime - event.startTime) / 1000.0);
+            jsonBuffer += eventString;
+            isFirstEvent = false;
+
+            if (jsonBuffer.length() >= WRITE_BUFFER_SIZE)
+            {
+                flushJson(traceFile, jsonBuffer);
+            }
+        }
+    }
+    jsonBuffer += "]}\n";
+    flushJson(traceFile, jsonBuffer);
+    traceFile.flush();
+
+    // Threads that are gone don't need their buffers anymore. The rest start over.
+    for (auto bufferIter = s_buffers.begin(); bufferIter != s_buffers.end();)
+    {
+        if ((*bufferIter)->threadExited)
+        {
+            bufferIter = s_buffers.erase(bufferIter);
+            continue;
+        }
+        (*bufferIter)->eventCount = 0;
+        ++bufferIter;
+    }
+}
+#endif
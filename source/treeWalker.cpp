@@ -0,0 +1,122 @@
+#include "treeWalker.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include <cstring>
+
+TreeWalker::TreeWalker(void)
+{
+    m_arena.reserve(ARENA_RESERVE_SIZE);
+}
+
+bool TreeWalker::walk(const fslib::Path &root, const RecordFunction &recordFunction)
+{
+    TRACE_SCOPE("treeWalk");
+    m_arena.clear();
+    m_pendingDirectories.clear();
+
+    // The root stays at the front of the buffer for the whole walk.
+    size_t rootLength = std::strlen(root.cString());
+    if (rootLength + 2 > FS_MAX_PATH)
+    {
+        LOG_ERROR("Error scanning \"%s\": path is too long.", root.cString());
+        return false;
+    }
+    std::memcpy(m_pathBuffer, root.cString(), rootLength);
+    if (rootLength > 0 && m_pathBuffer[rootLength - 1] != '/')
+    {
+        m_pathBuffer[rootLength++] = '/';
+    }
+    m_relativeOffset = rootLength;
+
+    if (!m_directory.open(root))
+    {
+        LOG_ERROR("Error scanning \"%s\": %s", root.cString(), fslib::getErrorString());
+        return false;
+    }
+    TreeWalker::walkDirectory(0, recordFunction);
+
+    while (!m_pendingDirectories.empty())
+    {
+        // Pull the path back out of the arena before the arena gets cut back and the directory's children get pushed over it.
+        size_t arenaOffset = m_pendingDirectories.back();
+        m_pendingDirectories.pop_back();
+        size_t relativeLength = std::strlen(&m_arena[arenaOffset]);
+        std::memcpy(&m_pathBuffer[m_relativeOffset], &m_arena[arenaOffset], relativeLength + 1);
+        m_arena.resize(arenaOffset);
+
+        // A directory we can't open is logged and skipped. Everything else is still worth dumping.
+        m_openPath = m_pathBuffer;
+        if (!m_directory.open(m_openPath))
+        {
+            LOG_ERROR("Error scanning \"%s\": %s", m_pathBuffer, fslib::getErrorString());
+            continue;
+        }
+        TreeWalker::walkDirectory(relativeLength, recordFunction);
+    }
+    return true;
+}
+
+size_t TreeWalker::appendName(size_t directoryLength, const char *name)
+{
+    size_t nameLength = std::strlen(name);
+    size_t separatorLength = directoryLength > 0 ? 1 : 0;
+    size_t relativeLength = directoryLength + separatorLength + nameLength;
+    if (m_relativeOffset + relativeLength + 1 > FS_MAX_PATH)
+    {
+        return 0;
+    }
+
+    char *namePosition = &m_pathBuffer[m_relativeOffset + directoryLength];
+    if (separatorLength > 0)
+    {
+        *namePosition++ = '/';
+    }
+    std::memcpy(namePosition, name, nameLength + 1);
+    return relativeLength;
+}
+
+void TreeWalker::walkDirectory(size_t directoryLength, const RecordFunction &recordFunction)
+{
+    int64_t entryCount = m_directory.getCount();
+    for (int64_t i = 0; i < entryCount; i++)
+    {
+        TreeRecord record;
+        record.path = &m_pathBuffer[m_relativeOffset];
+        record.pathLength = TreeWalker::appendName(directoryLength, m_directory[i]);
+        if (record.pathLength == 0)
+        {
+            LOG_ERROR("Skipping \"%s\" in \"%s\": path is too long.", m_directory[i], m_pathBuffer);
+            continue;
+        }
+
+        if (m_directory.isDirectory(i))
+        {
+            record.isDirectory = true;
+            recordFunction(record);
+            continue;
+        }
+
+        // There's no way to get the size without opening the file, but this is still much cheaper than reading it.
+        m_openPath = m_pathBuffer;
+        if (!m_file.open(m_openPath, FsOpenMode_Read))
+        {
+            LOG_ERROR("Error opening \"%s\" to get its size: %s", record.path, fslib::getErrorString());
+            continue;
+        }
+        record.size = m_file.getSize();
+        m_file.close();
+        recordFunction(record);
+    }
+
+    // Subdirectories go on the stack last to first so they come back off in the same order they're listed.
+    for (int64_t i = entryCount - 1; i >= 0; i--)
+    {
+        size_t relativeLength = 0;
+        if (!m_directory.isDirectory(i) || (relativeLength = TreeWalker::appendName(directoryLength, m_directory[i])) == 0)
+        {
+            continue;
+        }
+        m_pendingDirectories.push_back(m_arena.size());
+        m_arena.insert(m_arena.end(), &m_pathBuffer[m_relativeOffset], &m_pathBuffer[m_relativeOffset + relativeLength + 1]);
+    }
+}
@@ -0,0 +1,173 @@
+#include "updateMeta.hpp"
+#include "logger.hpp"
+#include <cstdio>
+#include <switch.h>
+
+namespace
+{
+    // Title ID of the SystemUpdate meta. Every firmware version has one listing every title that makes it up.
+    constexpr uint64_t SYSTEM_UPDATE_TITLE_ID = 0x0100000000000816;
+    // Most SystemUpdate versions that can be on the system at once. There's normally only one.
+    constexpr int32_t MAX_UPDATE_KEY_COUNT = 0x10;
+    // Most titles a SystemUpdate can list. Current firmware has around 150.
+    constexpr int32_t MAX_TITLE_COUNT = 0x400;
+    // Contents are listed this many at a time.
+    constexpr int32_t CONTENT_BATCH_COUNT = 0x10;
+} // namespace
+
+// Returns contentId as 32 lowercase hex digits.
+static std::string getContentIdString(const NcmContentId &contentId)
+{
+    char contentIdString[0x21] = {0};
+    for (size_t i = 0; i < sizeof(contentId.c); i++)
+    {
+        std::snprintf(&contentIdString[i * 2], 3, "%02x", contentId.c[i]);
+    }
+    return contentIdString;
+}
+
+// Adds the CNMT and every content of the title key points to to contentsOut. Returns false if any of it couldn't be read.
+static bool addTitleContents(NcmContentMetaDatabase &database, const NcmContentMetaKey &key, std::vector<updateMeta::UpdateContent> &contentsOut)
+{
+    // The CNMT isn't in its own content list, so it's asked for on its own.
+    NcmContentId metaId;
+    if (R_FAILED(ncmContentMetaDatabaseGetContentIdByType(&database, &metaId, &key, NcmContentType_Meta)))
+    {
+        LOG_ERROR("Error getting CNMT of %016llX v%u.", static_cast<unsigned long long>(key.id), key.version);
+        return false;
+    }
+    contentsOut.push_back({.titleId = key.id, .version = key.version, .contentId = getContentIdString(metaId), .isMeta = true});
+
+    NcmContentInfo contentInfos[CONTENT_BATCH_COUNT];
+    for (int32_t offset = 0;; offset += CONTENT_BATCH_COUNT)
+    {
+        int32_t infoCount = 0;
+        if (R_FAILED(ncmContentMetaDatabaseListContentInfo(&database, &infoCount, contentInfos, CONTENT_BATCH_COUNT, &key, offset)))
+        {
+            LOG_ERROR("Error listing contents of %016llX v%u.", static_cast<unsigned long long>(key.id), key.version);
+            return false;
+        }
+
+        for (int32_t i = 0; i < infoCount; i++)
+        {
+            contentsOut.push_back({.titleId = key.id,
+                                   .version = key.version,
+                                   .contentId = getContentIdString(contentInfos[i].content_id),
+                                   .isMeta = false});
+        }
+
+        if (infoCount < CONTENT_BATCH_COUNT)
+        {
+            return true;
+        }
+    }
+}
+
+// Returns whether the system has downloaded an update in the background that's waiting to be installed. Having more than one SystemUpdate
+// in the database doesn't mean that, so ns is asked.
+static bool isUpdateDownloaded(void)
+{
+    if (R_FAILED(nssuInitialize()))
+    {
+        LOG_WARNING("Error initializing nssu. Assuming there's no pending update.");
+        return false;
+    }
+
+    NsBackgroundNetworkUpdateState updateState = NsBackgroundNetworkUpdateState_None;
+    Result stateResult = nssuGetBackgroundNetworkUpdateState(&updateState);
+    nssuExit();
+    if (R_FAILED(stateResult))
+    {
+        LOG_WARNING("Error getting background update state. Assuming there's no pending update.");
+        return false;
+    }
+    return updateState == NsBackgroundNetworkUpdateState_Ready;
+}
+
+// Does the actual work of getLatestSystemUpdate once the database is open.
+static bool readSystemUpdate(NcmContentMetaDatabase &database,
+                             uint32_t &versionOut,
+                             bool &isPendingOut,
+                             std::vector<updateMeta::UpdateContent> &contentsOut)
+{
+    NcmContentMetaKey updateKeys[MAX_UPDATE_KEY_COUNT];
+    int32_t totalCount = 0, keyCount = 0;
+    if (R_FAILED(ncmContentMetaDatabaseList(&database,
+                                            &totalCount,
+                                            &keyCount,
+                                            updateKeys,
+                                            MAX_UPDATE_KEY_COUNT,
+                                            NcmContentMetaType_SystemUpdate,
+                                            SYSTEM_UPDATE_TITLE_ID,
+                                            SYSTEM_UPDATE_TITLE_ID,
+                                            SYSTEM_UPDATE_TITLE_ID,
+                                            NcmContentInstallType_Full)) ||
+        keyCount <= 0)
+    {
+        LOG_ERROR("Error listing SystemUpdate versions.");
+        return false;
+    }
+
+    const NcmContentMetaKey *latestKey = &updateKeys[0];
+    for (int32_t i = 1; i < keyCount; i++)
+    {
+        latestKey = updateKeys[i].version > latestKey->version ? &updateKeys[i] : latestKey;
+    }
+    versionOut = latestKey->version;
+    isPendingOut = isUpdateDownloaded();
+
+    // The SystemUpdate's own CNMT is what lists everything else.
+    if (!addTitleContents(database, *latestKey, contentsOut))
+    {
+        return false;
+    }
+
+    std::vector<NcmContentMetaInfo> titleInfos(MAX_TITLE_COUNT);
+    int32_t titleCount = 0;
+    if (R_FAILED(ncmContentMetaDatabaseListContentMetaInfo(&database, &titleCount, titleInfos.data(), MAX_TITLE_COUNT, latestKey, 0)))
+    {
+        LOG_ERROR("Error listing the titles of SystemUpdate v%u.", latestKey->version);
+        return false;
+    }
+
+    for (int32_t i = 0; i < titleCount; i++)
+    {
+        NcmContentMetaKey titleKey = {.id = titleInfos[i].id,
+                                      .version = titleInfos[i].version,
+                                      .type = titleInfos[i].content_meta_type,
+                                      .install_type = NcmContentInstallType_Full,
+                                      .padding = {0}};
+        if (!addTitleContents(database, titleKey, contentsOut))
+        {
+            return false;
+        }
+    }
+    LOG_INFO("SystemUpdate v%u lists %d titles and %u NCAs.",
+             versionOut,
+             static_cast<int>(titleCount),
+             static_cast<unsigned int>(contentsOut.size()));
+    return true;
+}
+
+bool updateMeta::getLatestSystemUpdate(uint32_t &versionOut, bool &isPendingOut, std::vector<updateMeta::UpdateContent> &contentsOut)
+{
+    contentsOut.clear();
+    if (R_FAILED(ncmInitialize()))
+    {
+        LOG_ERROR("Error initializing ncm.");
+        return false;
+    }
+
+    NcmContentMetaDatabase database;
+    if (R_FAILED(ncmOpenContentMetaDatabase(&database, NcmStorageId_BuiltInSystem)))
+    {
+        LOG_ERROR("Error opening system content meta database.");
+        ncmExit();
+        return false;
+    }
+
+    bool readUpdate = readSystemUpdate(database, versionOut, isPendingOut, contentsOut);
+    ncmContentMetaDatabaseClose(&database);
+    ncmExit();
+    return readUpdate;
+}
@@ -0,0 +1,326 @@
+#include "verify.hpp"
+#include "bufferPool.hpp"
+#include "console.hpp"
+#include "logger.hpp"
+#include "manifest.hpp"
+#include "manifestFile.hpp"
+#include "ncaVerifier.hpp"
+#include "progress.hpp"
+#include "scheduler.hpp"
+#include "strings.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <switch.h>
+#include <thread>
+#include <unordered_set>
+#include <zlib.h>
+
+namespace
+{
+    // What was wrong with a job.
+    enum VerifyStatus
+    {
+        STATUS_OK,
+        STATUS_DAMAGED,
+        STATUS_CRC_MISMATCH,
+        STATUS_HASH_MISMATCH,
+        STATUS_MANIFEST_MISMATCH
+    };
+
+    // What's printed for each status. Nothing is printed for STATUS_OK.
+    constexpr strings::names::Name STATUS_STRINGS[] = {strings::names::NAME_COUNT,
+                                                       strings::names::VERIFY_DAMAGED,
+                                                       strings::names::VERIFY_CRC_MISMATCH,
+                                                       strings::names::VERIFY_HASH_MISMATCH,
+                                                       strings::names::VERIFY_MANIFEST_MISMATCH};
+
+    // Everything the workers share.
+    struct VerifyState
+    {
+            std::vector<VerifyJob> &jobs;
+            // Next job nobody has taken yet.
+            std::atomic<size_t> nextJob = 0;
+            // Everything is read straight through the SD's filesystem so jobs can start in the middle of a file.
+            FsFileSystem sdmc;
+            // Running totals.
+            std::atomic<size_t> checkedCount = 0;
+            std::atomic<size_t> failedCount = 0;
+            std::atomic<size_t> ncaCount = 0;
+            std::atomic<size_t> ncaMismatchCount = 0;
+    };
+} // namespace
+
+// Reads job back, inflating it if it needs to be, and checks whatever it can. readBuffer and inflateBuffer are both bufferSize.
+static VerifyStatus checkJob(FsFileSystem &sdmc,
+                             const VerifyJob &job,
+                             unsigned char *readBuffer,
+                             unsigned char *inflateBuffer,
+                             size_t bufferSize,
+                             z_stream &stream,
+                             bool &isNcaOut)
+{
+    TRACE_SCOPE("verifyJob");
+    const char *sdmcPath = std::strchr(job.path.cString(), ':');
+    sdmcPath = sdmcPath ? sdmcPath + 1 : job.path.cString();
+
+    FsFile file;
+    if (R_FAILED(fsFsOpenFile(&sdmc, sdmcPath, FsOpenMode_Read, &file)))
+    {
+        LOG_ERROR("Error opening \"%s\" to verify.", job.path.cString());
+        return STATUS_DAMAGED;
+    }
+
+    // NCAs are hashed to check against their names, anything from a folder dump to check against the manifest.
+    NcaVerifier verifier{};
+    isNcaOut = NcaVerifier::isVerifiable(job.name.c_str());
+    bool needsHash = isNcaOut || job.hasHash;
+    if (needsHash)
+    {
+        verifier.begin();
+    }
+
+    uint32_t crc = 0;
+    int64_t dataSize = 0;
+    auto checkData = [&](const unsigned char *data, size_t size) {
+        if (job.hasCrc)
+        {
+            crc = crc32CalculateWithSeed(crc, data, size);
+        }
+        if (needsHash)
+        {
+            verifier.update(data, size);
+        }
+        dataSize += size;
+    };
+
+    if (job.isDeflated)
+    {
+        inflateReset(&stream);
+    }
+
+    // Stored data doesn't have an end to find, so it's always there.
+    bool streamEnded = !job.isDeflated;
+    bool readFailed = false;
+    for (int64_t offset = 0; offset < job.size && !readFailed;)
+    {
+        uint64_t readSize = job.size - offset > static_cast<int64_t>(bufferSize) ? bufferSize : job.size - offset;
+        uint64_t bytesRead = 0;
+        if (R_FAILED(fsFileRead(&file, job.offset + offset, readBuffer, readSize, FsReadOption_None, &bytesRead)) || bytesRead != readSize)
+        {
+            LOG_ERROR("Error reading \"%s\" at offset 0x%llX.", job.name.c_str(), static_cast<unsigned long long>(job.offset + offset));
+            readFailed = true;
+            break;
+        }
+        offset += bytesRead;
+        Progress::addBytes(bytesRead);
+
+        if (!job.isDeflated)
+        {
+            checkData(readBuffer, bytesRead);
+            continue;
+        }
+
+        stream.next_in = readBuffer;
+        stream.avail_in = bytesRead;
+        while (!streamEnded)
+        {
+            stream.next_out = inflateBuffer;
+            stream.avail_out = bufferSize;
+            int inflateResult = inflate(&stream, Z_NO_FLUSH);
+            if (inflateResult != Z_OK && inflateResult != Z_STREAM_END && inflateResult != Z_BUF_ERROR)
+            {
+                LOG_ERROR("Error inflating \"%s\": %d.", job.name.c_str(), inflateResult);
+                readFailed = true;
+                break;
+            }
+            checkData(inflateBuffer, bufferSize - stream.avail_out);
+            streamEnded = inflateResult == Z_STREAM_END;
+
+            // Room left over means it used up everything that was read. On to the next read.
+            if (stream.avail_in == 0 && stream.avail_out > 0)
+            {
+                break;
+            }
+        }
+    }
+    fsFileClose(&file);
+
+    int64_t expectedSize = job.isDeflated ? job.uncompressedSize : job.size;
+    if (readFailed || !streamEnded || dataSize != expectedSize)
+    {
+        return STATUS_DAMAGED;
+    }
+    else if (job.hasCrc && crc != job.crc)
+    {
+        return STATUS_CRC_MISMATCH;
+    }
+
+    // finish() has to run either way for the hash to be there to compare.
+    bool nameMatched = needsHash && verifier.finish(job.name.c_str());
+    if (isNcaOut && !nameMatched)
+    {
+        return STATUS_HASH_MISMATCH;
+    }
+    else if (job.hasHash && std::memcmp(verifier.getHash(), job.hash, SHA256_HASH_SIZE) != 0)
+    {
+        return STATUS_MANIFEST_MISMATCH;
+    }
+    return STATUS_OK;
+}
+
+// Takes jobs until there aren't any left. workerIndex is only used to spread the workers across cores.
+static void verifyWorkerFunction(VerifyState &state, size_t workerIndex)
+{
+    TRACE_THREAD_NAME("verify");
+    scheduler::assignCurrentThread(scheduler::ROLE_COMPUTE, workerIndex);
+    // One to read into and one to inflate into. Stored jobs only need the first.
+    unsigned char *buffers[2] = {nullptr};
+    if (!bufferPool::acquire(buffers, 2))
+    {
+        // Whatever this worker would have taken is left to the others. If none of them could start, verifyJobs fails the lot.
+        LOG_ERROR("Error acquiring verify buffers. The pool only has %lu.", static_cast<unsigned long>(bufferPool::getBufferCount()));
+        Console::printf(strings::getByName(strings::names::NO_TRANSFER_BUFFERS));
+        return;
+    }
+    size_t bufferSize = bufferPool::getBufferSize();
+
+    z_stream stream{};
+    inflateInit2(&stream, -MAX_WBITS);
+
+    for (size_t i = state.nextJob++; i < state.jobs.size(); i = state.nextJob++)
+    {
+        const VerifyJob &job = state.jobs[i];
+        bool isNca = false;
+        VerifyStatus status = checkJob(state.sdmc, job, buffers[0], buffers[1], bufferSize, stream, isNca);
+
+        ++state.checkedCount;
+        if (isNca && (status == STATUS_OK || status == STATUS_HASH_MISMATCH))
+        {
+            ++state.ncaCount;
+        }
+
+        if (status == STATUS_OK)
+        {
+            continue;
+        }
+        else if (status == STATUS_HASH_MISMATCH)
+        {
+            ++state.ncaMismatchCount;
+        }
+        ++state.failedCount;
+        Console::printf(strings::getByName(STATUS_STRINGS[status]), job.name.c_str());
+        LOG_WARNING("Verifying \"%s\" failed with status %d.", job.name.c_str(), status);
+    }
+
+    inflateEnd(&stream);
+    bufferPool::release(buffers, 2);
+}
+
+void verifyJobs(std::vector<VerifyJob> &jobs, size_t threadCount, VerifyResult &resultOut)
+{
+    VerifyState state{.jobs = jobs};
+    if (R_FAILED(fsOpenSdCardFileSystem(&state.sdmc)))
+    {
+        LOG_ERROR("Error opening SD filesystem to verify.");
+        resultOut.failedCount += jobs.size();
+        return;
+    }
+
+    // Biggest first so nobody's left with one huge file at the end while everyone else sits around.
+    std::stable_sort(jobs.begin(), jobs.end(), [](const VerifyJob &a, const VerifyJob &b) { return a.size > b.size; });
+
+    int64_t totalSize = 0;
+    for (const VerifyJob &job : jobs)
+    {
+        totalSize += job.size;
+    }
+    Progress::addTotalBytes(totalSize);
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threadCount && i < jobs.size(); i++)
+    {
+        workers.emplace_back(verifyWorkerFunction, std::ref(state), i);
+    }
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    fsFsClose(&state.sdmc);
+
+    // Anything nobody got to counts as failed, same as when the SD can't be opened.
+    resultOut.checkedCount += state.checkedCount;
+    resultOut.failedCount += state.failedCount + (jobs.size() - state.checkedCount);
+    resultOut.ncaCount += state.ncaCount;
+    resultOut.ncaMismatchCount += state.ncaMismatchCount;
+}
+
+bool verifyFolder(const fslib::Path &folderPath, const fslib::Path &manifestPath, size_t threadCount, VerifyResult &resultOut)
+{
+    Manifest manifest{};
+    if (!manifest.scan(folderPath))
+    {
+        return false;
+    }
+
+    // The manifest has the SHA-256 of every file that was finished. Dumps from before there was one can only have their NCAs checked.
+    ManifestFile manifestFile{};
+    bool hasManifest = manifestFile.load(manifestPath);
+    if (!hasManifest)
+    {
+        LOG_WARNING("No manifest at \"%s\". Only NCAs can be checked.", manifestPath.cString());
+    }
+
+    std::vector<VerifyJob> jobs;
+    jobs.reserve(manifest.getFileCount());
+    std::unordered_set<std::string> foundPaths;
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        if (entry.isDirectory)
+        {
+            continue;
+        }
+
+        // Anything the manifest doesn't have never finished copying, or was never part of the dump.
+        const ManifestFileEntry *record = hasManifest ? manifestFile.find(entry.path) : nullptr;
+        if (hasManifest && !record)
+        {
+            Console::printf(strings::getByName(strings::names::VERIFY_NOT_IN_MANIFEST), entry.path.c_str());
+            LOG_WARNING("\"%s\" is not in the manifest.", entry.path.c_str());
+            ++resultOut.checkedCount;
+            ++resultOut.failedCount;
+            continue;
+        }
+
+        // The size on the SD is what's read. If it's not what was recorded, the hash won't match either.
+        VerifyJob job{};
+        job.name = entry.path;
+        job.path = folderPath / entry.path;
+        job.size = entry.size;
+        if (record)
+        {
+            job.hasHash = true;
+            std::memcpy(job.hash, record->hash, SHA256_HASH_SIZE);
+            foundPaths.insert(entry.path);
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    // Files the manifest has that aren't there anymore are queued anyway. They just fail to open.
+    for (const auto &[path, record] : manifestFile.getEntries())
+    {
+        if (hasManifest && foundPaths.count(path) == 0)
+        {
+            VerifyJob job{};
+            job.name = path;
+            job.path = folderPath / path;
+            job.hasHash = true;
+            std::memcpy(job.hash, record.hash, SHA256_HASH_SIZE);
+            jobs.push_back(std::move(job));
+        }
+    }
+    verifyJobs(jobs, threadCount, resultOut);
+    return true;
+}
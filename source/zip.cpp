@@ -1,108 +1,506 @@
 #include "zip.hpp"
 #include "console.hpp"
+#include "copyEngine.hpp"
+#include "logger.hpp"
+#include "parallelDeflate.hpp"
 #include "strings.hpp"
+#include "zipFormat.hpp"
+#include "zipWriter.hpp"
+#include <atomic>
+#include <cstdio>
 #include <cstring>
-#include <ctime>
 #include <memory>
-#include <minizip/zip.h>
+#include <string>
+#include <switch.h>
+#include <thread>
+#include <vector>
 
 namespace
 {
-    // biggestDump's file transfers aren't threaded or this would be larger.
-    constexpr size_t FILE_TRANSFER_BUFFER_SIZE = 0x40000;
+    // Number of threads used to deflate. Applications only get three cores.
+    constexpr size_t DEFLATE_THREAD_COUNT = 3;
     // This is the error string so I don't actually have to type it over and over.
     const char *ERROR_STRING_TEMPLATE = "\t\t\t*%s*\n";
-} // namespace
+    // Volumes are named base + this.
+    const char *VOLUME_NAME_TEMPLATE = "%s.part%02u.zip";
+
+    // The end record plus the longest comment it can have.
+    constexpr int64_t MAX_END_SEARCH_SIZE = zipFormat::END_SIZE + 0xFFFF;
+
+    // Files planned for one volume of a split ZIP.
+    struct ZipVolume
+    {
+            std::vector<const ManifestEntry *> files;
+            int64_t size = 0;
+    };
+
+    // Writes each file as an entry in the ZIP. If deflate isn't nullptr, the entries are compressed with it.
+    class ZipSink : public TransferSink
+    {
+        public:
+            ZipSink(ZipWriter &zip, ParallelDeflate *deflate) : m_zip(zip), m_deflate(deflate) {};
+
+            bool beginFile(const fslib::Path &source, const fslib::Path &destination, int64_t fileSize) override
+            {
+                // Print we're copying so people know we're copying.
+                Console::printf(strings::getByName(strings::names::COPYING_FILE_ZIP), source.cString());
+
+                // Compressed entries get their deflate stream and CRC from ParallelDeflate.
+                if (!m_zip.beginEntry(destination.getPath() + 1, m_deflate != nullptr))
+                {
+                    Console::printf(ERROR_STRING_TEMPLATE, "Error opening file in ZIP!");
+                    return false;
+                }
 
-// Declarations here. Definitions later.
-static void copyFile(const fslib::Path &filePath, zipFile zip);
-static void copyDirectory(const fslib::Path &source, zipFile zip);
+                if (m_deflate)
+                {
+                    m_deflate->begin(m_writeToZip);
+                }
+                m_bytesWritten = 0;
+                return true;
+            }
 
-void copyDirectoryToZip(const fslib::Path &directoryPath, const char *zipPath)
+            bool write(const unsigned char *data, size_t dataSize) override
+            {
+                m_bytesWritten += dataSize;
+                // The engine doesn't know which chunk is last until after it's written, so the deflate stream is ended in endFile().
+                bool writeFailed = m_deflate ? !m_deflate->compress(data, dataSize, false) : !m_zip.write(data, dataSize);
+                if (writeFailed)
+                {
+                    Console::printf(ERROR_STRING_TEMPLATE, "Error writing to file in ZIP.");
+                }
+                return !writeFailed;
+            }
+
+            // Deflated entries get their CRC from ParallelDeflate's workers. Working it out on the hash thread too would be for nothing.
+            bool needsCrc(void) const override
+            {
+                return m_deflate == nullptr;
+            }
+
+            bool endFile(uint32_t crc, const uint8_t *hash, bool isComplete) override
+            {
+                // The entry is always closed so the ZIP itself stays valid, even if the file came up short.
+                bool writeFailed = m_deflate && !m_deflate->compress(NULL, 0, true);
+                if (m_deflate)
+                {
+                    crc = m_deflate->getCrc();
+                    m_bytesWritten = m_deflate->getUncompressedSize();
+                }
+
+                if (!m_zip.endEntry(crc, m_bytesWritten) || writeFailed)
+                {
+                    Console::printf(ERROR_STRING_TEMPLATE, "Error writing to file in ZIP.");
+                    return false;
+                }
+                return true;
+            }
+
+        private:
+            ZipWriter &m_zip;
+            ParallelDeflate *m_deflate = nullptr;
+            // Bytes written to the current entry.
+            uint64_t m_bytesWritten = 0;
+            // This is passed the deflate output. It's called on ParallelDeflate's output thread, but never while the write thread is
+            // touching m_zip.
+            ParallelDeflate::OutputFunction m_writeToZip = [this](const unsigned char *data, size_t dataSize) {
+                return m_zip.write(data, dataSize);
+            };
+    };
+} // namespace
+
+void copyManifestToZip(const Manifest &manifest, const fslib::Path &directoryPath, const char *zipPath, int compressionLevel)
 {
-    zipFile targetZip = zipOpen64(zipPath, APPEND_STATUS_CREATE);
-    if (!targetZip)
+    // Everything is known from the scan, so the ZIP can be allocated at exactly its stored size. Compressed ZIPs get trimmed at the end.
+    std::vector<const ManifestEntry *> files = manifest.getFilesLargestFirst();
+    int64_t zipSize = ZipWriter::getEndRecordSize();
+    for (const ManifestEntry *file : files)
+    {
+        fslib::Path filePath = directoryPath / file->path;
+        zipSize += ZipWriter::getStoredEntrySize(filePath.getPath() + 1, file->size);
+    }
+
+    ZipWriter targetZip{};
+    if (!targetZip.open(zipPath, zipSize))
     {
         Console::printf("Error opening \"%s\" for writing!\n", zipPath);
         return;
     }
-    copyDirectory(directoryPath, targetZip);
-    zipClose(targetZip, NULL);
+
+    // Only spin up the deflate threads if they're actually going to be used.
+    std::unique_ptr<ParallelDeflate> deflate;
+    if (compressionLevel != Z_NO_COMPRESSION)
+    {
+        deflate = std::make_unique<ParallelDeflate>(compressionLevel, DEFLATE_THREAD_COUNT);
+    }
+
+    // Same read, hash, and write threads the folder dump uses. The next file is read while the last is still being written to the ZIP.
+    {
+        ZipSink sink(targetZip, deflate.get());
+        CopyEngine engine(sink);
+        for (const ManifestEntry *file : files)
+        {
+            fslib::Path filePath = directoryPath / file->path;
+            engine.submit(filePath, filePath);
+        }
+        engine.finish();
+    }
+
+    if (!targetZip.close())
+    {
+        Console::printf(ERROR_STRING_TEMPLATE, "Error writing ZIP central directory.");
+    }
 }
 
-static void copyFile(const fslib::Path &filePath, zipFile zip)
+// Reads a little endian value from data.
+static inline uint16_t read16(const uint8_t *data)
 {
-    std::time_t timer;
-    std::time(&timer);
-    std::tm *localTime = std::localtime(&timer);
+    return data[0] | data[1] << 8;
+}
 
+static inline uint32_t read32(const uint8_t *data)
+{
+    return read16(data) | static_cast<uint32_t>(read16(&data[2])) << 16;
+}
 
-    zip_fileinfo fileInfo = {.tmz_date = {.tm_sec = localTime->tm_sec,
-                                          .tm_hour = localTime->tm_hour,
-                                          .tm_mday = localTime->tm_mday,
-                                          .tm_mon = localTime->tm_mon,
-                                          .tm_year = localTime->tm_year + 1900},
-                             .dosDate = 0,
-                             .internal_fa = 0,
-                             .external_fa = 0};
+static inline uint64_t read64(const uint8_t *data)
+{
+    return read32(data) | static_cast<uint64_t>(read32(&data[4])) << 32;
+}
+
+// Reads size bytes at offset in file to dataOut. Returns false if it couldn't read all of them.
+static bool readZipBytes(FsFile &file, int64_t offset, size_t size, std::vector<uint8_t> &dataOut)
+{
+    uint64_t bytesRead = 0;
+    dataOut.resize(size);
+    return R_SUCCEEDED(fsFileRead(&file, offset, dataOut.data(), size, FsReadOption_None, &bytesRead)) && bytesRead == size;
+}
 
-    int zipError = zipOpenNewFileInZip64(zip, filePath.getPath() + 1, &fileInfo, NULL, 0, NULL, 0, NULL, Z_NO_COMPRESSION, 0, 0);
-    if (zipError != ZIP_OK)
+// Finds the central directory from the records at the end of file. Returns false if it isn't a ZIP or the end is missing.
+static bool findCentralDirectory(FsFile &file, int64_t fileSize, int64_t &offsetOut, int64_t &sizeOut, uint64_t &entryCountOut)
+{
+    // The end record is the last thing in the file unless there's a comment after it.
+    int64_t tailSize = fileSize < MAX_END_SEARCH_SIZE ? fileSize : MAX_END_SEARCH_SIZE;
+    std::vector<uint8_t> tail;
+    if (tailSize < zipFormat::END_SIZE || !readZipBytes(file, fileSize - tailSize, tailSize, tail))
     {
-        Console::printf(ERROR_STRING_TEMPLATE, "Error opening file in ZIP!");
-        return;
+        return false;
     }
 
-    fslib::File sourceFile(filePath, FsOpenMode_Read);
-    if (!sourceFile.isOpen())
+    int64_t endOffset = tailSize - zipFormat::END_SIZE;
+    while (endOffset >= 0 && read32(&tail[endOffset]) != zipFormat::END_SIGNATURE)
     {
-        Console::printf(ERROR_STRING_TEMPLATE, fslib::getErrorString());
-        return;
+        --endOffset;
+    }
+
+    if (endOffset < 0)
+    {
+        return false;
+    }
+    entryCountOut = read16(&tail[endOffset + 10]);
+    sizeOut = read32(&tail[endOffset + 12]);
+    offsetOut = read32(&tail[endOffset + 16]);
+
+    // ZIP64 has a locator right before the end record pointing at the real values.
+    int64_t locatorOffset = endOffset - zipFormat::ZIP64_LOCATOR_SIZE;
+    if (locatorOffset < 0 || read32(&tail[locatorOffset]) != zipFormat::ZIP64_LOCATOR_SIGNATURE)
+    {
+        return true;
     }
 
-    // Print we're copying so people know we're copying.
-    Console::printf(strings::getByName(strings::names::COPYING_FILE_ZIP), filePath.cString());
-    std::unique_ptr<unsigned char[]> fileBuffer(new unsigned char[FILE_TRANSFER_BUFFER_SIZE]);
-    for (int64_t i = 0; i < sourceFile.getSize();)
+    std::vector<uint8_t> zip64End;
+    if (!readZipBytes(file, read64(&tail[locatorOffset + 8]), zipFormat::ZIP64_END_SIZE, zip64End) ||
+        read32(zip64End.data()) != zipFormat::ZIP64_END_SIGNATURE)
     {
-        size_t bytesRead = sourceFile.read(fileBuffer.get(), FILE_TRANSFER_BUFFER_SIZE);
-        if (bytesRead <= 0)
+        return false;
+    }
+    entryCountOut = read64(&zip64End[32]);
+    sizeOut = read64(&zip64End[40]);
+    offsetOut = read64(&zip64End[48]);
+    return true;
+}
+
+// Turns every file in the central directory into a verify job. Returns false if the central directory is damaged.
+static bool readCentralDirectory(FsFile &file, const std::vector<uint8_t> &centralDirectory, const char *zipPath, std::vector<VerifyJob> &jobsOut)
+{
+    std::vector<uint8_t> localHeader;
+    size_t offset = 0;
+    while (offset + zipFormat::CENTRAL_HEADER_SIZE <= centralDirectory.size())
+    {
+        const uint8_t *header = &centralDirectory[offset];
+        if (read32(header) != zipFormat::CENTRAL_HEADER_SIGNATURE)
+        {
+            return false;
+        }
+
+        uint16_t method = read16(&header[10]);
+        uint16_t nameLength = read16(&header[28]);
+        uint16_t extraLength = read16(&header[30]);
+        uint16_t commentLength = read16(&header[32]);
+        size_t nextOffset = offset + zipFormat::CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+        if (nextOffset > centralDirectory.size())
         {
-            Console::printf(ERROR_STRING_TEMPLATE, fslib::getErrorString());
-            return;
+            return false;
         }
 
-        zipError = zipWriteInFileInZip(zip, fileBuffer.get(), bytesRead);
-        if (zipError != ZIP_OK)
+        VerifyJob job{};
+        job.name.assign(reinterpret_cast<const char *>(&header[zipFormat::CENTRAL_HEADER_SIZE]), nameLength);
+        job.path = zipPath;
+        job.isDeflated = method == zipFormat::METHOD_DEFLATED;
+        job.hasCrc = true;
+        job.crc = read32(&header[16]);
+        job.size = read32(&header[20]);
+        job.uncompressedSize = read32(&header[24]);
+        int64_t localHeaderOffset = read32(&header[42]);
+
+        // Anything too big for the header is in the ZIP64 extra field, in this order.
+        const uint8_t *extra = &header[zipFormat::CENTRAL_HEADER_SIZE + nameLength];
+        for (size_t extraOffset = 0; extraOffset + 4 <= extraLength;)
         {
-            Console::printf(ERROR_STRING_TEMPLATE, "Error writing to file in ZIP.");
-            return;
+            uint16_t fieldId = read16(&extra[extraOffset]);
+            uint16_t fieldSize = read16(&extra[extraOffset + 2]);
+            const uint8_t *field = &extra[extraOffset + 4];
+            const uint8_t *fieldEnd = field + fieldSize;
+            if (fieldId == zipFormat::ZIP64_EXTRA_ID && extraOffset + 4 + fieldSize <= extraLength)
+            {
+                if (job.uncompressedSize == zipFormat::ZIP64_MARKER && field + 8 <= fieldEnd)
+                {
+                    job.uncompressedSize = read64(field);
+                    field += 8;
+                }
+                if (job.size == zipFormat::ZIP64_MARKER && field + 8 <= fieldEnd)
+                {
+                    job.size = read64(field);
+                    field += 8;
+                }
+                if (localHeaderOffset == zipFormat::ZIP64_MARKER && field + 8 <= fieldEnd)
+                {
+                    localHeaderOffset = read64(field);
+                }
+            }
+            extraOffset += 4 + fieldSize;
         }
-        i += bytesRead;
+        offset = nextOffset;
+
+        // Directories have nothing to check.
+        if (job.name.empty() || job.name.back() == '/')
+        {
+            continue;
+        }
+
+        // The local header's name and extra field don't have to match the central directory's, so the data's offset comes from it.
+        if (!readZipBytes(file, localHeaderOffset, zipFormat::LOCAL_HEADER_SIZE, localHeader) ||
+            read32(localHeader.data()) != zipFormat::LOCAL_HEADER_SIGNATURE ||
+            (method != zipFormat::METHOD_STORED && method != zipFormat::METHOD_DEFLATED))
+        {
+            LOG_ERROR("Error reading local header of \"%s\".", job.name.c_str());
+            return false;
+        }
+        job.offset = localHeaderOffset + zipFormat::LOCAL_HEADER_SIZE + read16(&localHeader[26]) + read16(&localHeader[28]);
+        jobsOut.push_back(std::move(job));
     }
-    zipCloseFileInZip(zip);
-    Console::printf(strings::getByName(strings::names::DONE));
+    return true;
 }
 
-static void copyDirectory(const fslib::Path &source, zipFile zip)
+bool verifyZip(const char *zipPath, size_t threadCount, VerifyResult &resultOut)
 {
-    fslib::Directory sourceDir(source);
-    if (!sourceDir.isOpen())
+    const char *sdmcPath = std::strchr(zipPath, ':');
+    sdmcPath = sdmcPath ? sdmcPath + 1 : zipPath;
+
+    FsFileSystem sdmc;
+    if (R_FAILED(fsOpenSdCardFileSystem(&sdmc)))
     {
-        Console::printf(ERROR_STRING_TEMPLATE, fslib::getErrorString());
+        LOG_ERROR("Error opening SD filesystem to verify ZIP.");
+        return false;
+    }
+
+    FsFile zipFile;
+    if (R_FAILED(fsFsOpenFile(&sdmc, sdmcPath, FsOpenMode_Read, &zipFile)))
+    {
+        LOG_ERROR("Error opening \"%s\" to verify.", zipPath);
+        fsFsClose(&sdmc);
+        return false;
+    }
+
+    // Only the central directory is read here. The entries themselves are read on the verify threads.
+    int64_t zipSize = 0, centralDirectoryOffset = 0, centralDirectorySize = 0;
+    uint64_t entryCount = 0;
+    std::vector<uint8_t> centralDirectory;
+    std::vector<VerifyJob> jobs;
+    bool isValid = R_SUCCEEDED(fsFileGetSize(&zipFile, &zipSize)) &&
+                   findCentralDirectory(zipFile, zipSize, centralDirectoryOffset, centralDirectorySize, entryCount) &&
+                   centralDirectoryOffset >= 0 && centralDirectorySize >= 0 && centralDirectoryOffset + centralDirectorySize <= zipSize &&
+                   readZipBytes(zipFile, centralDirectoryOffset, centralDirectorySize, centralDirectory) &&
+                   readCentralDirectory(zipFile, centralDirectory, zipPath, jobs);
+    fsFileClose(&zipFile);
+    fsFsClose(&sdmc);
+
+    if (!isValid)
+    {
+        LOG_ERROR("\"%s\" is missing its central directory or it's damaged.", zipPath);
+        return false;
+    }
+
+    if (jobs.size() > entryCount)
+    {
+        LOG_WARNING("\"%s\" has more entries than its end record says.", zipPath);
+    }
+    verifyJobs(jobs, threadCount, resultOut);
+    return true;
+}
+
+// Figures out which volume every file goes in. Largest files go first into whichever volume has the least in it and still has room, so
+// the volumes come out about even and the writers finish around the same time. Returns false if volumeSize can't hold every file.
+static bool planVolumes(const Manifest &manifest,
+                        const fslib::Path &directoryPath,
+                        int64_t volumeSize,
+                        size_t minimumVolumeCount,
+                        std::vector<ZipVolume> &volumesOut)
+{
+    // Every volume needs room for its end records and at least something else.
+    int64_t usableSize = volumeSize - ZipWriter::getEndRecordSize();
+    if (usableSize <= 0)
+    {
+        LOG_ERROR("ZIP volume size 0x%llX can't even hold the end records.", static_cast<unsigned long long>(volumeSize));
+        return false;
+    }
+
+    int64_t totalSize = 0;
+    std::vector<const ManifestEntry *> files = manifest.getFilesLargestFirst();
+    std::vector<int64_t> entrySizes;
+    for (const ManifestEntry *file : files)
+    {
+        fslib::Path filePath = directoryPath / file->path;
+        entrySizes.push_back(ZipWriter::getStoredEntrySize(filePath.getPath() + 1, file->size));
+        totalSize += entrySizes.back();
+
+        // Files can't be split across volumes, so one that doesn't fit in a whole volume can't be dumped this way at all.
+        if (entrySizes.back() > usableSize)
+        {
+            LOG_ERROR("\"%s\" is larger than a whole ZIP volume.", file->path.c_str());
+            return false;
+        }
+    }
+
+    // Enough volumes to hold everything, but at least one per writer so they all have something to do.
+    size_t volumeCount = (totalSize + usableSize - 1) / usableSize;
+    volumeCount = volumeCount < minimumVolumeCount ? minimumVolumeCount : volumeCount;
+    std::vector<ZipVolume> volumes(volumeCount);
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        ZipVolume *target = nullptr;
+        for (ZipVolume &volume : volumes)
+        {
+            if (volume.size + entrySizes[i] <= usableSize && (!target || volume.size < target->size))
+            {
+                target = &volume;
+            }
+        }
+
+        // Nothing has room left. Every file fits in an empty volume, so it just gets a new one.
+        if (!target)
+        {
+            volumes.emplace_back();
+            target = &volumes.back();
+        }
+        target->files.push_back(files[i]);
+        target->size += entrySizes[i];
+    }
+
+    // Empty volumes are only possible if there are fewer files than writers.
+    volumesOut.clear();
+    for (ZipVolume &volume : volumes)
+    {
+        if (!volume.files.empty())
+        {
+            volumesOut.push_back(std::move(volume));
+        }
+    }
+    return true;
+}
+
+// Writes one volume start to finish. Each one is a complete ZIP with its own writer and pipeline. writerCount is how many are being written
+// at once and writerIndex is which writer this is.
+static void writeVolume(const ZipVolume &volume,
+                        const fslib::Path &directoryPath,
+                        const char *volumePath,
+                        size_t writerCount,
+                        size_t writerIndex)
+{
+    ZipWriter volumeZip{};
+    if (!volumeZip.open(volumePath, volume.size + ZipWriter::getEndRecordSize()))
+    {
+        Console::printf("Error opening \"%s\" for writing!\n", volumePath);
         return;
     }
 
-    for (int64_t i = 0; i < sourceDir.getCount(); i++)
     {
-        fslib::Path newSource = source / sourceDir[i];
-        if (sourceDir.isDirectory(i))
+        ZipSink sink(volumeZip, nullptr);
+        CopyEngine engine(sink, writerCount, writerIndex);
+        for (const ManifestEntry *file : volume.files)
         {
-            copyDirectory(newSource, zip);
+            fslib::Path filePath = directoryPath / file->path;
+            engine.submit(filePath, filePath);
         }
-        else
+        engine.finish();
+    }
+
+    if (!volumeZip.close())
+    {
+        Console::printf(ERROR_STRING_TEMPLATE, "Error writing ZIP central directory.");
+    }
+}
+
+void copyManifestToSplitZip(const Manifest &manifest,
+                            const fslib::Path &directoryPath,
+                            const char *zipPathBase,
+                            int64_t volumeSize,
+                            size_t writerCount)
+{
+    std::vector<ZipVolume> volumes;
+    if (!planVolumes(manifest, directoryPath, volumeSize, writerCount, volumes))
+    {
+        Console::printf(ERROR_STRING_TEMPLATE, "Error planning ZIP volumes.");
+        return;
+    }
+
+    std::vector<std::string> volumePaths;
+    for (size_t i = 0; i < volumes.size(); i++)
+    {
+        char volumePath[FS_MAX_PATH];
+        std::snprintf(volumePath, FS_MAX_PATH, VOLUME_NAME_TEMPLATE, zipPathBase, static_cast<unsigned int>(i + 1));
+        volumePaths.push_back(volumePath);
+    }
+
+    // Volumes left over from a bigger dump would make this one look like it's missing files.
+    for (unsigned int i = volumes.size() + 1;; i++)
+    {
+        char volumePath[FS_MAX_PATH];
+        std::snprintf(volumePath, FS_MAX_PATH, VOLUME_NAME_TEMPLATE, zipPathBase, i);
+        if (!fslib::fileExists(volumePath) || !fslib::deleteFile(volumePath))
         {
-            copyFile(newSource, zip);
+            break;
         }
     }
+
+    // Every writer grabs the next volume nobody has started yet.
+    std::atomic<size_t> nextVolume = 0;
+    auto writerFunction = [&](size_t writerIndex) {
+        for (size_t i = nextVolume++; i < volumes.size(); i = nextVolume++)
+        {
+            writeVolume(volumes[i], directoryPath, volumePaths[i].c_str(), writerCount, writerIndex);
+        }
+    };
+
+    std::vector<std::thread> writers;
+    for (size_t i = 0; i < writerCount && i < volumes.size(); i++)
+    {
+        writers.emplace_back(writerFunction, i);
+    }
+
+    for (std::thread &writer : writers)
+    {
+        writer.join();
+    }
 }
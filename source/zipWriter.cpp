@@ -0,0 +1,178 @@
+#include "zipWriter.hpp"
+#include "zipFormat.hpp"
+#include <cstring>
+#include <ctime>
+
+// These append little endian values to buffer.
+static void append16(std::vector<uint8_t> &buffer, uint16_t value)
+{
+    buffer.push_back(value & 0xFF);
+    buffer.push_back(value >> 8);
+}
+
+static void append32(std::vector<uint8_t> &buffer, uint32_t value)
+{
+    append16(buffer, value & 0xFFFF);
+    append16(buffer, value >> 16);
+}
+
+static void append64(std::vector<uint8_t> &buffer, uint64_t value)
+{
+    append32(buffer, value & 0xFFFFFFFF);
+    append32(buffer, value >> 32);
+}
+
+bool ZipWriter::open(const char *path, int64_t reserveSize)
+{
+    if (!m_file.open(path, reserveSize))
+    {
+        return false;
+    }
+    m_centralDirectory.clear();
+    m_entryCount = 0;
+
+    // Split ZIPs open more than one of these at once, so no std::localtime.
+    std::time_t timer;
+    std::time(&timer);
+    std::tm localTime;
+    localtime_r(&timer, &localTime);
+    m_dosTime = (localTime.tm_hour << 11) | (localTime.tm_min << 5) | (localTime.tm_sec / 2);
+    m_dosDate = ((localTime.tm_year - 80) << 9) | ((localTime.tm_mon + 1) << 5) | localTime.tm_mday;
+    return true;
+}
+
+bool ZipWriter::beginEntry(const char *name, bool isDeflated)
+{
+    m_entryName = name;
+    m_entryIsDeflated = isDeflated;
+    m_entryOffset = m_file.getOffset();
+    m_entryCompressedSize = 0;
+
+    // CRC and sizes aren't known until the data has gone through, so they're zero here and written to the data descriptor. The ZIP64
+    // field is still needed so readers know the descriptor has 64 bit sizes.
+    std::vector<uint8_t> localHeader;
+    localHeader.reserve(zipFormat::LOCAL_HEADER_SIZE + m_entryName.length() + zipFormat::LOCAL_ZIP64_EXTRA_SIZE);
+    append32(localHeader, zipFormat::LOCAL_HEADER_SIGNATURE);
+    append16(localHeader, zipFormat::ZIP_VERSION);
+    append16(localHeader, zipFormat::FLAG_DATA_DESCRIPTOR);
+    append16(localHeader, isDeflated ? zipFormat::METHOD_DEFLATED : zipFormat::METHOD_STORED);
+    append16(localHeader, m_dosTime);
+    append16(localHeader, m_dosDate);
+    append32(localHeader, 0);
+    append32(localHeader, zipFormat::ZIP64_MARKER);
+    append32(localHeader, zipFormat::ZIP64_MARKER);
+    append16(localHeader, m_entryName.length());
+    append16(localHeader, zipFormat::LOCAL_ZIP64_EXTRA_SIZE);
+    localHeader.insert(localHeader.end(), m_entryName.begin(), m_entryName.end());
+    append16(localHeader, zipFormat::ZIP64_EXTRA_ID);
+    append16(localHeader, zipFormat::LOCAL_ZIP64_EXTRA_SIZE - 4);
+    append64(localHeader, 0);
+    append64(localHeader, 0);
+
+    return m_file.write(localHeader.data(), localHeader.size());
+}
+
+bool ZipWriter::write(const void *data, size_t dataSize)
+{
+    if (dataSize == 0)
+    {
+        return true;
+    }
+    m_entryCompressedSize += dataSize;
+    return m_file.write(data, dataSize);
+}
+
+bool ZipWriter::endEntry(uint32_t crc, uint64_t uncompressedSize)
+{
+    std::vector<uint8_t> dataDescriptor;
+    dataDescriptor.reserve(zipFormat::DATA_DESCRIPTOR_SIZE);
+    append32(dataDescriptor, zipFormat::DATA_DESCRIPTOR_SIGNATURE);
+    append32(dataDescriptor, crc);
+    append64(dataDescriptor, m_entryCompressedSize);
+    append64(dataDescriptor, uncompressedSize);
+    if (!m_file.write(dataDescriptor.data(), dataDescriptor.size()))
+    {
+        return false;
+    }
+
+    // Central directory record. Everything that can be is pushed to the ZIP64 field.
+    append32(m_centralDirectory, zipFormat::CENTRAL_HEADER_SIGNATURE);
+    append16(m_centralDirectory, zipFormat::ZIP_VERSION);
+    append16(m_centralDirectory, zipFormat::ZIP_VERSION);
+    append16(m_centralDirectory, zipFormat::FLAG_DATA_DESCRIPTOR);
+    append16(m_centralDirectory, m_entryIsDeflated ? zipFormat::METHOD_DEFLATED : zipFormat::METHOD_STORED);
+    append16(m_centralDirectory, m_dosTime);
+    append16(m_centralDirectory, m_dosDate);
+    append32(m_centralDirectory, crc);
+    append32(m_centralDirectory, zipFormat::ZIP64_MARKER);
+    append32(m_centralDirectory, zipFormat::ZIP64_MARKER);
+    append16(m_centralDirectory, m_entryName.length());
+    append16(m_centralDirectory, zipFormat::CENTRAL_ZIP64_EXTRA_SIZE);
+    append16(m_centralDirectory, 0);
+    append16(m_centralDirectory, 0);
+    append16(m_centralDirectory, 0);
+    append32(m_centralDirectory, 0);
+    append32(m_centralDirectory, zipFormat::ZIP64_MARKER);
+    m_centralDirectory.insert(m_centralDirectory.end(), m_entryName.begin(), m_entryName.end());
+    append16(m_centralDirectory, zipFormat::ZIP64_EXTRA_ID);
+    append16(m_centralDirectory, zipFormat::CENTRAL_ZIP64_EXTRA_SIZE - 4);
+    append64(m_centralDirectory, uncompressedSize);
+    append64(m_centralDirectory, m_entryCompressedSize);
+    append64(m_centralDirectory, m_entryOffset);
+    ++m_entryCount;
+    return true;
+}
+
+bool ZipWriter::close(void)
+{
+    if (!m_file.isOpen())
+    {
+        return false;
+    }
+
+    // ZIP64 end record, its locator, and the regular end record all go on the end of the central directory so it's one write.
+    uint64_t centralDirectoryOffset = m_file.getOffset();
+    uint64_t centralDirectorySize = m_centralDirectory.size();
+    uint64_t zip64EndOffset = centralDirectoryOffset + centralDirectorySize;
+
+    append32(m_centralDirectory, zipFormat::ZIP64_END_SIGNATURE);
+    append64(m_centralDirectory, zipFormat::ZIP64_END_SIZE - 12);
+    append16(m_centralDirectory, zipFormat::ZIP_VERSION);
+    append16(m_centralDirectory, zipFormat::ZIP_VERSION);
+    append32(m_centralDirectory, 0);
+    append32(m_centralDirectory, 0);
+    append64(m_centralDirectory, m_entryCount);
+    append64(m_centralDirectory, m_entryCount);
+    append64(m_centralDirectory, centralDirectorySize);
+    append64(m_centralDirectory, centralDirectoryOffset);
+
+    append32(m_centralDirectory, zipFormat::ZIP64_LOCATOR_SIGNATURE);
+    append32(m_centralDirectory, 0);
+    append64(m_centralDirectory, zip64EndOffset);
+    append32(m_centralDirectory, 1);
+
+    append32(m_centralDirectory, zipFormat::END_SIGNATURE);
+    append16(m_centralDirectory, 0);
+    append16(m_centralDirectory, 0);
+    append16(m_centralDirectory, 0xFFFF);
+    append16(m_centralDirectory, 0xFFFF);
+    append32(m_centralDirectory, zipFormat::ZIP64_MARKER);
+    append32(m_centralDirectory, zipFormat::ZIP64_MARKER);
+    append16(m_centralDirectory, 0);
+
+    bool closed = m_file.write(m_centralDirectory.data(), m_centralDirectory.size());
+    // The file still gets closed even if the end couldn't be written.
+    return m_file.close() && closed;
+}
+
+int64_t ZipWriter::getStoredEntrySize(const char *name, int64_t dataSize)
+{
+    int64_t nameLength = std::strlen(name);
+    return zipFormat::LOCAL_HEADER_SIZE + nameLength + zipFormat::LOCAL_ZIP64_EXTRA_SIZE + dataSize + zipFormat::DATA_DESCRIPTOR_SIZE +
+           zipFormat::CENTRAL_HEADER_SIZE + nameLength + zipFormat::CENTRAL_ZIP64_EXTRA_SIZE;
+}
+
+int64_t ZipWriter::getEndRecordSize(void)
+{
+    return zipFormat::ZIP64_END_SIZE + zipFormat::ZIP64_LOCATOR_SIZE + zipFormat::END_SIZE;
+}
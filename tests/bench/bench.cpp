@@ -0,0 +1,357 @@
+// Times every dump mode against synthetic Contents trees on the host. Trees are generated once under the data directory and reused as long
+// as the scale matches. Every mode runs in a process of its own so peak RSS is that mode's and nothing else's. One JSON object is printed
+// per profile and mode, with the same fields biggestDump.stats records on the Switch plus the profile and peak RSS.
+#include "bufferPool.hpp"
+#include "console.hpp"
+#include "hostFs.hpp"
+#include "io.hpp"
+#include "ioTuner.hpp"
+#include "logger.hpp"
+#include "manifest.hpp"
+#include "manifestFile.hpp"
+#include "progress.hpp"
+#include "stopwatch.hpp"
+#include "strings.hpp"
+#include "syntheticFile.hpp"
+#include "tar.hpp"
+#include "zip.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+namespace
+{
+    // Same paths and settings as threadFunctions.cpp so the numbers mean the same thing.
+    const char *CONTENTS_PATH = "sys:/Contents";
+    const char *FIRMWARE_FOLDER = "sdmc:/FirmwareDump";
+    const char *FIRMWARE_MANIFEST = "sdmc:/FirmwareDump.manifest";
+    const char *FIRMWARE_ZIP = "sdmc:/FirmwareDump.zip";
+    const char *FIRMWARE_TAR = "sdmc:/FirmwareDump.tar";
+    const char *FIRMWARE_SPLIT_ZIP = "sdmc:/FirmwareDump";
+    const char *TUNING_CACHE = "sdmc:/switch/biggestDump.tuning";
+    const char *TUNING_PROBE = "sdmc:/switch/biggestDump.probe";
+    constexpr int64_t SPLIT_VOLUME_SIZE = 0xFFFFFFFF;
+    constexpr size_t SPLIT_WRITER_COUNT = 2;
+    constexpr size_t FOLDER_PIPELINE_COUNT = 2;
+    constexpr double BYTES_PER_MB = 1024.0 * 1024.0;
+
+    // Files this size and under are never scaled down. They're what makes the tiny profile tiny.
+    constexpr int64_t UNSCALED_SIZE = 0x10000;
+    // Title directories are named like the ones in registered and get this many NCAs each.
+    constexpr size_t FILES_PER_DIRECTORY = 64;
+
+    // A group of files in a profile. Sizes are spread evenly from minSize to maxSize.
+    struct FileGroup
+    {
+            size_t count;
+            int64_t minSize;
+            int64_t maxSize;
+    };
+
+    // A kind of Contents tree.
+    struct TreeProfile
+    {
+            const char *name;
+            std::vector<FileGroup> groups;
+    };
+
+    // tiny is thousands of CNMT-sized NCAs where per-file cost is everything. large is a few multi-GB NCAs where it's nothing. mixed is
+    // shaped like a real firmware, lots of small ones, some medium, a few big.
+    const TreeProfile PROFILES[] = {{"tiny", {{4000, 0x800, 0x4000}}},
+                                    {"large", {{3, 0x80000000, 0xC0000000}}},
+                                    {"mixed", {{200, 0x800, 0x4000}, {60, 0x10000, 0x800000}, {4, 0x4000000, 0x10000000}}}};
+
+    // A dump mode and how to run it.
+    struct DumpMode
+    {
+            const char *name;
+            void (*run)(const Manifest &manifest);
+    };
+
+    const DumpMode MODES[] = {{"folder",
+                               [](const Manifest &manifest) {
+                                   ManifestFile manifestFile{};
+                                   manifestFile.create(FIRMWARE_MANIFEST, FIRMWARE_FOLDER);
+                                   copyManifest(manifest, CONTENTS_PATH, FIRMWARE_FOLDER, FOLDER_PIPELINE_COUNT, &manifestFile);
+                               }},
+                              {"zip", [](const Manifest &manifest) { copyManifestToZip(manifest, CONTENTS_PATH, FIRMWARE_ZIP); }},
+                              {"compressedZip",
+                               [](const Manifest &manifest) { copyManifestToZip(manifest, CONTENTS_PATH, FIRMWARE_ZIP, Z_DEFAULT_COMPRESSION); }},
+                              {"tar", [](const Manifest &manifest) { copyManifestToTar(manifest, CONTENTS_PATH, FIRMWARE_TAR); }},
+                              {"splitZip", [](const Manifest &manifest) {
+                                   copyManifestToSplitZip(manifest, CONTENTS_PATH, FIRMWARE_SPLIT_ZIP, SPLIT_VOLUME_SIZE, SPLIT_WRITER_COUNT);
+                               }}};
+
+    // Where the command line says to go.
+    struct BenchOptions
+    {
+            std::string dataDirectory = "benchData";
+            std::string profiles = "tiny,large,mixed";
+            std::string modes = "folder,zip,compressedZip,tar,splitZip";
+            double scale = 1.0;
+    };
+} // namespace
+
+// Returns whether name is one of the comma separated names in list.
+static bool isListed(const std::string &list, const char *name)
+{
+    std::string paddedList = "," + list + ",";
+    return paddedList.find(std::string(",") + name + ",") != paddedList.npos;
+}
+
+// Makes sure profileDirectory has profile's tree at scale. Trees that are already there at the same scale are left alone.
+static bool generateTree(const TreeProfile &profile, const std::string &profileDirectory, double scale)
+{
+    hostFs::mapDevice("bench", profileDirectory);
+    char scaleString[0x40] = {0};
+    std::snprintf(scaleString, sizeof(scaleString), "%.6f\n", scale);
+
+    {
+        char existingScale[0x40] = {0};
+        fslib::File scaleFile("bench:/scale", FsOpenMode_Read);
+        if (scaleFile.isOpen() && scaleFile.read(existingScale, sizeof(existingScale) - 1) > 0 && std::strcmp(existingScale, scaleString) == 0)
+        {
+            return true;
+        }
+    }
+
+    std::fprintf(stderr, "Generating %s tree at scale %g in %s...\n", profile.name, scale, profileDirectory.c_str());
+    fslib::deleteDirectoryRecursively("bench:/sys");
+    fslib::deleteFile("bench:/scale");
+    if (!fslib::createDirectory("bench:/") || !fslib::createDirectory("bench:/sys") || !fslib::createDirectory("bench:/sys/Contents") ||
+        !fslib::createDirectory("bench:/sys/Contents/registered") || !fslib::createDirectory("bench:/sys/Contents/placehld"))
+    {
+        std::fprintf(stderr, "%s\n", fslib::getErrorString());
+        return false;
+    }
+
+    size_t fileIndex = 0;
+    for (const FileGroup &group : profile.groups)
+    {
+        for (size_t i = 0; i < group.count; i++, fileIndex++)
+        {
+            int64_t fileSize = group.minSize + (group.count > 1 ? (group.maxSize - group.minSize) * static_cast<int64_t>(i) /
+                                                                      static_cast<int64_t>(group.count - 1)
+                                                                : 0);
+            int64_t scaledSize = static_cast<int64_t>(static_cast<double>(fileSize) * scale);
+            fileSize = fileSize <= UNSCALED_SIZE ? fileSize : (scaledSize < UNSCALED_SIZE ? UNSCALED_SIZE : scaledSize);
+
+            char directoryName[0x10] = {0};
+            std::snprintf(directoryName, sizeof(directoryName), "%08X", static_cast<unsigned int>(fileIndex / FILES_PER_DIRECTORY));
+            fslib::Path directoryPath = fslib::Path("bench:/sys/Contents/registered") / directoryName;
+            if (!fslib::createDirectory(directoryPath) || !syntheticFile::createNca(directoryPath, fileSize, fileIndex + 1))
+            {
+                std::fprintf(stderr, "Error generating NCA %u: %s\n", static_cast<unsigned int>(fileIndex), fslib::getErrorString());
+                return false;
+            }
+        }
+    }
+
+    fslib::File scaleFile("bench:/scale", FsOpenMode_Create | FsOpenMode_Write);
+    scaleFile << scaleString;
+    return scaleFile.isOpen();
+}
+
+// Deletes whatever the last mode left on the fake SD. The tuning cache stays.
+static void cleanSdmc(void)
+{
+    fslib::Directory sdmcDirectory("sdmc:/");
+    for (int64_t i = 0; i < sdmcDirectory.getCount(); i++)
+    {
+        if (std::strncmp(sdmcDirectory[i], "FirmwareDump", 12) != 0)
+        {
+            continue;
+        }
+
+        fslib::Path entryPath = fslib::Path("sdmc:/") / sdmcDirectory[i];
+        if (sdmcDirectory.isDirectory(i))
+        {
+            fslib::deleteDirectoryRecursively(entryPath);
+        }
+        else
+        {
+            fslib::deleteFile(entryPath);
+        }
+    }
+}
+
+// Runs mode once against what's mapped to sys and prints how it went. This is the child's whole life. Returns the exit code.
+static int runMode(const char *profileName, const DumpMode &mode)
+{
+    logger::initialize();
+    strings::initialize();
+    if (!bufferPool::initialize())
+    {
+        std::fprintf(stderr, "Error allocating buffer pool.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Stands in for the UI thread so the console's queue keeps getting emptied.
+    std::atomic<bool> consoleIsRunning = true;
+    std::thread consoleThread([&consoleIsRunning]() {
+        while (consoleIsRunning)
+        {
+            Console::render();
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+        Console::render();
+    });
+
+    int exitCode = EXIT_FAILURE;
+    Manifest manifest{};
+    if (!manifest.scan(CONTENTS_PATH))
+    {
+        std::fprintf(stderr, "Error scanning %s: %s\n", CONTENTS_PATH, fslib::getErrorString());
+    }
+    else
+    {
+        // Tuning is timed by itself. It only ever happens once per data directory.
+        if (!ioTuner::load(TUNING_CACHE))
+        {
+            ioTuner::tune(manifest, CONTENTS_PATH, TUNING_PROBE);
+            ioTuner::save(TUNING_CACHE);
+        }
+        bufferPool::setBufferSize(ioTuner::getSlotSize());
+
+        Progress::reset(manifest.getTotalSize());
+        std::chrono::steady_clock::time_point startTime = stopwatch::start();
+        mode.run(manifest);
+        double seconds = stopwatch::getMillisecondsSince(startTime) / 1000.0;
+        Progress::finish();
+
+        // ru_maxrss is in KB on Linux.
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        double fileCount = static_cast<double>(manifest.getFileCount());
+        double totalSize = static_cast<double>(manifest.getTotalSize());
+        std::printf("{\"profile\":\"%s\",\"mode\":\"%s\",\"files\":%u,\"bytes\":%lld,\"seconds\":%.3f,\"mbPerSecond\":%.2f,"
+                    "\"filesPerSecond\":%.2f,\"peakRss\":%llu,\"slotSize\":%u,\"slotCount\":%u,\"verified\":%u,\"mismatches\":%u}\n",
+                    profileName,
+                    mode.name,
+                    static_cast<unsigned int>(manifest.getFileCount()),
+                    static_cast<long long>(manifest.getTotalSize()),
+                    seconds,
+                    seconds > 0.0 ? totalSize / BYTES_PER_MB / seconds : 0.0,
+                    seconds > 0.0 ? fileCount / seconds : 0.0,
+                    static_cast<unsigned long long>(usage.ru_maxrss) * 1024,
+                    static_cast<unsigned int>(ioTuner::getSlotSize()),
+                    static_cast<unsigned int>(ioTuner::getSlotCount()),
+                    static_cast<unsigned int>(Progress::getVerifiedCount()),
+                    static_cast<unsigned int>(Progress::getMismatchCount()));
+        std::fflush(stdout);
+        exitCode = Progress::getMismatchCount() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    consoleIsRunning = false;
+    consoleThread.join();
+    bufferPool::exit();
+    logger::exit();
+    return exitCode;
+}
+
+// Reads the command line into optionsOut. Returns false and prints how to use this if it doesn't make sense.
+static bool parseOptions(int argc, char **argv, BenchOptions &optionsOut)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value && std::strcmp(argv[i], "--data") == 0)
+        {
+            optionsOut.dataDirectory = value;
+        }
+        else if (value && std::strcmp(argv[i], "--profiles") == 0)
+        {
+            optionsOut.profiles = value;
+        }
+        else if (value && std::strcmp(argv[i], "--modes") == 0)
+        {
+            optionsOut.modes = value;
+        }
+        else if (value && std::strcmp(argv[i], "--scale") == 0 && std::strtod(value, nullptr) > 0.0)
+        {
+            optionsOut.scale = std::strtod(value, nullptr);
+        }
+        else
+        {
+            std::fprintf(stderr,
+                         "Usage: %s [--data dir] [--profiles tiny,large,mixed] [--modes folder,zip,compressedZip,tar,splitZip] "
+                         "[--scale factor]\n",
+                         argv[0]);
+            return false;
+        }
+        ++i;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options{};
+    if (!parseOptions(argc, argv, options))
+    {
+        return EXIT_FAILURE;
+    }
+
+    ::mkdir(options.dataDirectory.c_str(), 0755);
+    char *dataDirectory = ::realpath(options.dataDirectory.c_str(), nullptr);
+    if (!dataDirectory)
+    {
+        std::fprintf(stderr, "Error opening %s.\n", options.dataDirectory.c_str());
+        return EXIT_FAILURE;
+    }
+    std::string dataPath = dataDirectory;
+    std::free(dataDirectory);
+
+    // Every profile shares the SD so the tuning is only measured once.
+    hostFs::mapDevice("sdmc", dataPath + "/sdmc");
+    fslib::createDirectory("sdmc:/");
+    fslib::createDirectory("sdmc:/switch");
+
+    int exitCode = EXIT_SUCCESS;
+    for (const TreeProfile &profile : PROFILES)
+    {
+        std::string profileDirectory = dataPath + "/" + profile.name;
+        if (!isListed(options.profiles, profile.name))
+        {
+            continue;
+        }
+        else if (!generateTree(profile, profileDirectory, options.scale))
+        {
+            return EXIT_FAILURE;
+        }
+        hostFs::mapDevice("sys", profileDirectory + "/sys");
+
+        for (const DumpMode &mode : MODES)
+        {
+            if (!isListed(options.modes, mode.name))
+            {
+                continue;
+            }
+
+            // Nothing's running yet on this side, so forking is safe.
+            pid_t child = fork();
+            if (child == 0)
+            {
+                std::_Exit(runMode(profile.name, mode));
+            }
+
+            int status = 0;
+            if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            {
+                std::fprintf(stderr, "%s dump of the %s tree failed.\n", mode.name, profile.name);
+                exitCode = EXIT_FAILURE;
+            }
+            cleanSdmc();
+        }
+    }
+    return exitCode;
+}
@@ -0,0 +1,106 @@
+#pragma once
+// The part of FsLib the dump engines use, on top of POSIX. Devices are resolved through hostFs.
+#include <switch.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <vector>
+
+namespace fslib
+{
+    // device:/path/to/something.
+    class Path
+    {
+        public:
+            Path(void) = default;
+            Path(const char *path);
+            Path(const std::string &path);
+
+            // Appends a path component with a slash between.
+            Path operator/(std::string_view component) const;
+            Path &operator/=(std::string_view component);
+            // Appends text as-is.
+            Path operator+(std::string_view text) const;
+
+            // Whole path, device included.
+            const char *cString(void) const;
+            // Path without the device.
+            const char *getPath(void) const;
+            // Whether there's anything in it.
+            bool isValid(void) const;
+
+        private:
+            std::string m_path;
+    };
+
+    // A file opened with FsOpenMode flags. Reads and writes pick up where the last one left off.
+    class File
+    {
+        public:
+            File(void) = default;
+            // Opens path. FsOpenMode_Create replaces whatever was there with a file of fileSize bytes.
+            File(const fslib::Path &path, uint32_t openFlags, int64_t fileSize = 0);
+            ~File();
+
+            // No copying.
+            File(const File &) = delete;
+            File &operator=(const File &) = delete;
+
+            bool open(const fslib::Path &path, uint32_t openFlags, int64_t fileSize = 0);
+            void close(void);
+            bool isOpen(void) const;
+
+            // Returns the bytes read or written, or -1 on failure.
+            ssize_t read(void *buffer, size_t bufferSize);
+            ssize_t write(const void *buffer, size_t bufferSize);
+            bool flush(void);
+            int64_t getSize(void) const;
+            // Sets the file's size. The offset stays where it is.
+            bool resize(int64_t size);
+
+            File &operator<<(const char *string);
+            File &operator<<(const std::string &string);
+
+        private:
+            int m_descriptor = -1;
+            int64_t m_offset = 0;
+            int64_t m_size = 0;
+    };
+
+    // Everything in a directory, sorted by name so runs are repeatable.
+    class Directory
+    {
+        public:
+            Directory(void) = default;
+            Directory(const fslib::Path &path);
+
+            bool open(const fslib::Path &path);
+            bool isOpen(void) const;
+
+            int64_t getCount(void) const;
+            bool isDirectory(int64_t index) const;
+            // Name of the entry at index.
+            const char *operator[](int64_t index) const;
+
+        private:
+            struct DirectoryEntry
+            {
+                    std::string name;
+                    bool isDirectory = false;
+            };
+
+            std::vector<DirectoryEntry> m_entries;
+            bool m_isOpen = false;
+    };
+
+    // Returns what went wrong last on the calling thread.
+    const char *getErrorString(void);
+
+    bool createDirectory(const fslib::Path &path);
+    bool deleteDirectoryRecursively(const fslib::Path &path);
+    bool deleteFile(const fslib::Path &path);
+    bool directoryExists(const fslib::Path &path);
+    bool fileExists(const fslib::Path &path);
+} // namespace fslib
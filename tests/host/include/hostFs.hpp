@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+// Maps the devices biggestDump's paths start with to directories on the host. fslib and the fs* functions in switch.h both go through
+// here, so sys:/Contents can be any tree and sdmc:/ any scratch directory.
+namespace hostFs
+{
+    // Makes device:/ resolve to hostDirectory. device is the name without the colon.
+    void mapDevice(const std::string &device, const std::string &hostDirectory);
+    // Returns where path is on the host. Paths without a device are returned as they are. Unmapped devices resolve to an empty string.
+    std::string getHostPath(const std::string &path);
+} // namespace hostFs
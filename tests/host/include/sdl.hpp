@@ -0,0 +1,46 @@
+#pragma once
+// Just enough of SDLLib for Console and Progress to compile. Nothing is drawn. Textures are empty and text goes nowhere.
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+struct SDL_Texture;
+
+enum SDL_TextureAccess
+{
+    SDL_TEXTUREACCESS_STATIC,
+    SDL_TEXTUREACCESS_STREAMING,
+    SDL_TEXTUREACCESS_TARGET
+};
+
+namespace sdl
+{
+    typedef union
+    {
+            uint32_t raw;
+            uint8_t rgba[4];
+    } Color;
+
+    class Texture
+    {
+        public:
+            SDL_Texture *get(void);
+            void render(SDL_Texture *target, int x, int y);
+            bool clear(sdl::Color color);
+    };
+
+    using SharedTexture = std::shared_ptr<sdl::Texture>;
+
+    class TextureManager
+    {
+        public:
+            static sdl::SharedTexture createLoadTexture(std::string_view name, int width, int height, int accessFlags);
+    };
+
+    namespace text
+    {
+        static constexpr int NO_TEXT_WRAP = -1;
+
+        void render(SDL_Texture *target, int x, int y, int fontSize, int wrapWidth, sdl::Color color, const char *format, ...);
+    } // namespace text
+} // namespace sdl
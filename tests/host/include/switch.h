@@ -0,0 +1,145 @@
+#pragma once
+// Just the part of libnx the dump engines use, backed by the host. Everything here is implemented in source/switch.cpp. Paths passed to
+// the fs* functions are relative to whatever hostFs has sdmc mapped to.
+#include <cstddef>
+#include <cstdint>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef u32 Result;
+typedef u32 Handle;
+
+#define R_SUCCEEDED(res) ((res) == 0)
+#define R_FAILED(res) ((res) != 0)
+
+#define FS_MAX_PATH 0x301
+#define CUR_PROCESS_HANDLE 0xFFFF8001
+
+// fs
+enum
+{
+    FsOpenMode_Read = 1 << 0,
+    FsOpenMode_Write = 1 << 1,
+    FsOpenMode_Append = 1 << 2,
+    FsOpenMode_Create = 1 << 8
+};
+
+typedef enum
+{
+    FsReadOption_None = 0
+} FsReadOption;
+
+typedef enum
+{
+    FsWriteOption_None = 0,
+    FsWriteOption_Flush = 1
+} FsWriteOption;
+
+typedef struct
+{
+        int unused;
+} FsFileSystem;
+
+typedef struct
+{
+        int fd;
+} FsFile;
+
+Result fsOpenSdCardFileSystem(FsFileSystem *fileSystem);
+Result fsFsCreateFile(FsFileSystem *fileSystem, const char *path, s64 size, u32 option);
+Result fsFsDeleteFile(FsFileSystem *fileSystem, const char *path);
+Result fsFsOpenFile(FsFileSystem *fileSystem, const char *path, u32 mode, FsFile *file);
+Result fsFsGetFreeSpace(FsFileSystem *fileSystem, const char *path, s64 *out);
+Result fsFsGetTotalSpace(FsFileSystem *fileSystem, const char *path, s64 *out);
+void fsFsClose(FsFileSystem *fileSystem);
+Result fsFileRead(FsFile *file, s64 offset, void *buffer, u64 readSize, u32 option, u64 *bytesRead);
+Result fsFileWrite(FsFile *file, s64 offset, const void *buffer, u64 writeSize, u32 option);
+Result fsFileSetSize(FsFile *file, s64 size);
+Result fsFileGetSize(FsFile *file, s64 *out);
+Result fsFileFlush(FsFile *file);
+void fsFileClose(FsFile *file);
+
+// crypto
+#define SHA256_HASH_SIZE 0x20
+
+typedef struct
+{
+        u32 intermediate_hash[8];
+        u8 block[0x40];
+        size_t bits_consumed;
+        size_t num_buffered;
+} Sha256Context;
+
+void sha256ContextCreate(Sha256Context *context);
+void sha256ContextUpdate(Sha256Context *context, const void *src, size_t size);
+void sha256ContextGetHash(Sha256Context *context, void *dst);
+u32 crc32CalculateWithSeed(u32 seed, const void *src, size_t size);
+
+// svc. Core masks and priorities are accepted and ignored. Reading them back gives what an application's main thread starts with. The only
+// info the host has is how much memory is resident.
+typedef enum
+{
+    InfoType_TotalMemorySize = 6,
+    InfoType_UsedMemorySize = 7
+} InfoType;
+
+typedef union
+{
+        u64 x;
+        u32 w;
+} CpuRegister;
+
+typedef struct
+{
+        u32 error_desc;
+        u32 pad[3];
+        CpuRegister cpu_gprs[29];
+        CpuRegister fp;
+        CpuRegister lr;
+        CpuRegister sp;
+        CpuRegister pc;
+        u32 pstate;
+        u32 afsr0;
+        u32 afsr1;
+        u32 esr;
+        CpuRegister far;
+} ThreadExceptionDump;
+
+Result svcGetInfo(u64 *out, u32 id0, Handle handle, u64 id1);
+Result svcGetThreadCoreMask(s32 *preferredCore, u64 *affinityMask, Handle handle);
+Result svcSetThreadCoreMask(Handle handle, s32 preferredCore, u32 affinityMask);
+Result svcGetThreadPriority(s32 *priority, Handle handle);
+Result svcSetThreadPriority(Handle handle, u32 priority);
+void svcSleepThread(s64 nano);
+Handle threadGetCurHandle(void);
+
+// set. The host is always American English.
+typedef enum
+{
+    SetLanguage_JA = 0,
+    SetLanguage_ENUS = 1,
+    SetLanguage_FR = 2,
+    SetLanguage_DE = 3,
+    SetLanguage_IT = 4,
+    SetLanguage_ES = 5,
+    SetLanguage_ZHCN = 6,
+    SetLanguage_KO = 7,
+    SetLanguage_NL = 8,
+    SetLanguage_PT = 9,
+    SetLanguage_RU = 10,
+    SetLanguage_ZHTW = 11,
+    SetLanguage_ENGB = 12,
+    SetLanguage_FRCA = 13,
+    SetLanguage_ES419 = 14,
+    SetLanguage_ZHHANS = 15,
+    SetLanguage_ZHHANT = 16,
+    SetLanguage_PTBR = 17
+} SetLanguage;
+
+Result setInitialize(void);
+Result setGetSystemLanguage(u64 *languageCode);
+Result setMakeLanguage(u64 languageCode, SetLanguage *language);
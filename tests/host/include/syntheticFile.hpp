@@ -0,0 +1,13 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstdint>
+
+// Makes files full of noise for the benchmark and the tests. The same seed always makes the same bytes.
+namespace syntheticFile
+{
+    // Writes fileSize bytes to path. hashOut gets the SHA-256 if it isn't nullptr. Returns false on failure.
+    bool create(const fslib::Path &path, int64_t fileSize, uint64_t seed, uint8_t *hashOut = nullptr);
+    // Same, but it's written to directoryPath and named after its SHA-256 like a real NCA. pathOut gets where it ended up if it isn't
+    // nullptr.
+    bool createNca(const fslib::Path &directoryPath, int64_t fileSize, uint64_t seed, fslib::Path *pathOut = nullptr);
+} // namespace syntheticFile
@@ -0,0 +1,328 @@
+#include "fslib.hpp"
+#include "hostFs.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace
+{
+    // Device name -> host directory.
+    std::unordered_map<std::string, std::string> s_deviceMap;
+    std::mutex s_deviceMutex;
+    // Engines run on several threads, so every one gets its own.
+    thread_local std::string s_errorString = "No error.";
+} // namespace
+
+// Records what errno says went wrong with path.
+static void setError(const char *function, const fslib::Path &path)
+{
+    s_errorString = std::string(function) + " \"" + path.cString() + "\": " + std::strerror(errno);
+}
+
+// nftw callback that deletes whatever it's handed.
+static int deleteEntry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return ::remove(path);
+}
+
+void hostFs::mapDevice(const std::string &device, const std::string &hostDirectory)
+{
+    std::lock_guard<std::mutex> deviceLock(s_deviceMutex);
+    s_deviceMap[device] = hostDirectory;
+}
+
+std::string hostFs::getHostPath(const std::string &path)
+{
+    size_t colon = path.find(':');
+    if (colon == path.npos)
+    {
+        return path;
+    }
+
+    std::lock_guard<std::mutex> deviceLock(s_deviceMutex);
+    auto device = s_deviceMap.find(path.substr(0, colon));
+    if (device == s_deviceMap.end())
+    {
+        return std::string();
+    }
+    return device->second + path.substr(colon + 1);
+}
+
+fslib::Path::Path(const char *path) : m_path(path) {}
+
+fslib::Path::Path(const std::string &path) : m_path(path) {}
+
+fslib::Path fslib::Path::operator/(std::string_view component) const
+{
+    fslib::Path newPath = *this;
+    newPath /= component;
+    return newPath;
+}
+
+fslib::Path &fslib::Path::operator/=(std::string_view component)
+{
+    // FsLib trims the slashes on both sides so there's always exactly one.
+    while (!m_path.empty() && m_path.back() == '/')
+    {
+        m_path.pop_back();
+    }
+    while (!component.empty() && component.front() == '/')
+    {
+        component.remove_prefix(1);
+    }
+    m_path.append("/").append(component);
+    return *this;
+}
+
+fslib::Path fslib::Path::operator+(std::string_view text) const
+{
+    fslib::Path newPath = *this;
+    newPath.m_path.append(text);
+    return newPath;
+}
+
+const char *fslib::Path::cString(void) const
+{
+    return m_path.c_str();
+}
+
+const char *fslib::Path::getPath(void) const
+{
+    size_t colon = m_path.find(':');
+    return colon == m_path.npos ? m_path.c_str() : &m_path[colon + 1];
+}
+
+bool fslib::Path::isValid(void) const
+{
+    return !m_path.empty();
+}
+
+fslib::File::File(const fslib::Path &path, uint32_t openFlags, int64_t fileSize)
+{
+    File::open(path, openFlags, fileSize);
+}
+
+fslib::File::~File()
+{
+    File::close();
+}
+
+bool fslib::File::open(const fslib::Path &path, uint32_t openFlags, int64_t fileSize)
+{
+    File::close();
+
+    // Create always means a new file. Anything opened to write can be read too, same as on the Switch.
+    int flags = openFlags & (FsOpenMode_Write | FsOpenMode_Append | FsOpenMode_Create) ? O_RDWR : O_RDONLY;
+    flags |= openFlags & FsOpenMode_Create ? O_CREAT | O_TRUNC : 0;
+    std::string hostPath = hostFs::getHostPath(path.cString());
+    m_descriptor = ::open(hostPath.c_str(), flags | O_CLOEXEC, 0644);
+    if (m_descriptor < 0)
+    {
+        setError("open", path);
+        return false;
+    }
+
+    if ((openFlags & FsOpenMode_Create) && fileSize > 0 && ::ftruncate(m_descriptor, fileSize) != 0)
+    {
+        setError("ftruncate", path);
+        File::close();
+        return false;
+    }
+
+    struct stat fileStat;
+    ::fstat(m_descriptor, &fileStat);
+    m_size = fileStat.st_size;
+    m_offset = openFlags & FsOpenMode_Append ? m_size : 0;
+    return true;
+}
+
+void fslib::File::close(void)
+{
+    if (m_descriptor >= 0)
+    {
+        ::close(m_descriptor);
+    }
+    m_descriptor = -1;
+    m_offset = 0;
+    m_size = 0;
+}
+
+bool fslib::File::isOpen(void) const
+{
+    return m_descriptor >= 0;
+}
+
+ssize_t fslib::File::read(void *buffer, size_t bufferSize)
+{
+    ssize_t bytesRead = ::pread(m_descriptor, buffer, bufferSize, m_offset);
+    if (bytesRead < 0)
+    {
+        s_errorString = std::string("pread: ") + std::strerror(errno);
+        return -1;
+    }
+    m_offset += bytesRead;
+    return bytesRead;
+}
+
+ssize_t fslib::File::write(const void *buffer, size_t bufferSize)
+{
+    const unsigned char *data = static_cast<const unsigned char *>(buffer);
+    for (size_t written = 0; written < bufferSize;)
+    {
+        ssize_t bytesWritten = ::pwrite(m_descriptor, &data[written], bufferSize - written, m_offset);
+        if (bytesWritten <= 0)
+        {
+            s_errorString = std::string("pwrite: ") + std::strerror(errno);
+            return -1;
+        }
+        written += bytesWritten;
+        m_offset += bytesWritten;
+    }
+    m_size = std::max(m_size, m_offset);
+    return bufferSize;
+}
+
+bool fslib::File::flush(void)
+{
+    return m_descriptor >= 0;
+}
+
+int64_t fslib::File::getSize(void) const
+{
+    return m_size;
+}
+
+bool fslib::File::resize(int64_t size)
+{
+    if (::ftruncate(m_descriptor, size) != 0)
+    {
+        s_errorString = std::string("ftruncate: ") + std::strerror(errno);
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+fslib::File &fslib::File::operator<<(const char *string)
+{
+    File::write(string, std::strlen(string));
+    return *this;
+}
+
+fslib::File &fslib::File::operator<<(const std::string &string)
+{
+    File::write(string.c_str(), string.length());
+    return *this;
+}
+
+fslib::Directory::Directory(const fslib::Path &path)
+{
+    Directory::open(path);
+}
+
+bool fslib::Directory::open(const fslib::Path &path)
+{
+    m_entries.clear();
+    m_isOpen = false;
+
+    std::string hostPath = hostFs::getHostPath(path.cString());
+    DIR *directory = ::opendir(hostPath.c_str());
+    if (!directory)
+    {
+        setError("opendir", path);
+        return false;
+    }
+
+    for (struct dirent *entry = ::readdir(directory); entry; entry = ::readdir(directory))
+    {
+        if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+
+        struct stat entryStat;
+        std::string entryPath = hostPath + "/" + entry->d_name;
+        bool isDirectory = ::stat(entryPath.c_str(), &entryStat) == 0 && S_ISDIR(entryStat.st_mode);
+        m_entries.push_back({entry->d_name, isDirectory});
+    }
+    ::closedir(directory);
+
+    std::sort(m_entries.begin(), m_entries.end(), [](const DirectoryEntry &a, const DirectoryEntry &b) { return a.name < b.name; });
+    m_isOpen = true;
+    return true;
+}
+
+bool fslib::Directory::isOpen(void) const
+{
+    return m_isOpen;
+}
+
+int64_t fslib::Directory::getCount(void) const
+{
+    return static_cast<int64_t>(m_entries.size());
+}
+
+bool fslib::Directory::isDirectory(int64_t index) const
+{
+    return m_entries[index].isDirectory;
+}
+
+const char *fslib::Directory::operator[](int64_t index) const
+{
+    return m_entries[index].name.c_str();
+}
+
+const char *fslib::getErrorString(void)
+{
+    return s_errorString.c_str();
+}
+
+bool fslib::createDirectory(const fslib::Path &path)
+{
+    if (::mkdir(hostFs::getHostPath(path.cString()).c_str(), 0755) != 0 && errno != EEXIST)
+    {
+        setError("mkdir", path);
+        return false;
+    }
+    return true;
+}
+
+bool fslib::deleteDirectoryRecursively(const fslib::Path &path)
+{
+    // Children first so every directory is empty by the time it's removed.
+    if (::nftw(hostFs::getHostPath(path.cString()).c_str(), deleteEntry, 16, FTW_DEPTH | FTW_PHYS) != 0)
+    {
+        setError("nftw", path);
+        return false;
+    }
+    return true;
+}
+
+bool fslib::deleteFile(const fslib::Path &path)
+{
+    if (::unlink(hostFs::getHostPath(path.cString()).c_str()) != 0)
+    {
+        setError("unlink", path);
+        return false;
+    }
+    return true;
+}
+
+bool fslib::directoryExists(const fslib::Path &path)
+{
+    struct stat pathStat;
+    return ::stat(hostFs::getHostPath(path.cString()).c_str(), &pathStat) == 0 && S_ISDIR(pathStat.st_mode);
+}
+
+bool fslib::fileExists(const fslib::Path &path)
+{
+    struct stat pathStat;
+    return ::stat(hostFs::getHostPath(path.cString()).c_str(), &pathStat) == 0 && S_ISREG(pathStat.st_mode);
+}
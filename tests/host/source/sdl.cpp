@@ -0,0 +1,20 @@
+#include "sdl.hpp"
+
+SDL_Texture *sdl::Texture::get(void)
+{
+    return nullptr;
+}
+
+void sdl::Texture::render(SDL_Texture *, int, int) {}
+
+bool sdl::Texture::clear(sdl::Color)
+{
+    return true;
+}
+
+sdl::SharedTexture sdl::TextureManager::createLoadTexture(std::string_view, int, int, int)
+{
+    return std::make_shared<sdl::Texture>();
+}
+
+void sdl::text::render(SDL_Texture *, int, int, int, int, sdl::Color, const char *, ...) {}
@@ -0,0 +1,322 @@
+#include "hostFs.hpp"
+#include <switch.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/statvfs.h>
+#include <thread>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace
+{
+    // Anything that isn't zero is a failure. The engines never look past that.
+    constexpr Result HOST_ERROR = 1;
+
+    // SHA-256 round constants.
+    constexpr u32 SHA256_K[64] = {0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+                                  0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+                                  0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+                                  0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+                                  0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+                                  0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+                                  0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+                                  0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+} // namespace
+
+// Returns where the SD path path is on the host.
+static std::string getSdmcPath(const char *path)
+{
+    return hostFs::getHostPath(std::string("sdmc:") + path);
+}
+
+static inline u32 rotateRight(u32 value, int count)
+{
+    return (value >> count) | (value << (32 - count));
+}
+
+// Runs one 64 byte block through the compression function.
+static void sha256ProcessBlock(Sha256Context *context, const u8 *block)
+{
+    u32 schedule[64];
+    for (int i = 0; i < 16; i++)
+    {
+        schedule[i] = static_cast<u32>(block[i * 4]) << 24 | static_cast<u32>(block[i * 4 + 1]) << 16 |
+                      static_cast<u32>(block[i * 4 + 2]) << 8 | static_cast<u32>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++)
+    {
+        u32 s0 = rotateRight(schedule[i - 15], 7) ^ rotateRight(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+        u32 s1 = rotateRight(schedule[i - 2], 17) ^ rotateRight(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+        schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+    }
+
+    u32 state[8];
+    std::memcpy(state, context->intermediate_hash, sizeof(state));
+    for (int i = 0; i < 64; i++)
+    {
+        u32 s1 = rotateRight(state[4], 6) ^ rotateRight(state[4], 11) ^ rotateRight(state[4], 25);
+        u32 choice = (state[4] & state[5]) ^ (~state[4] & state[6]);
+        u32 temp1 = state[7] + s1 + choice + SHA256_K[i] + schedule[i];
+        u32 s0 = rotateRight(state[0], 2) ^ rotateRight(state[0], 13) ^ rotateRight(state[0], 22);
+        u32 majority = (state[0] & state[1]) ^ (state[0] & state[2]) ^ (state[1] & state[2]);
+        u32 temp2 = s0 + majority;
+        std::memmove(&state[1], &state[0], sizeof(u32) * 7);
+        state[4] += temp1;
+        state[0] = temp1 + temp2;
+    }
+
+    for (int i = 0; i < 8; i++)
+    {
+        context->intermediate_hash[i] += state[i];
+    }
+}
+
+Result fsOpenSdCardFileSystem(FsFileSystem *fileSystem)
+{
+    fileSystem->unused = 0;
+    return hostFs::getHostPath("sdmc:/").empty() ? HOST_ERROR : 0;
+}
+
+Result fsFsCreateFile(FsFileSystem *, const char *path, s64 size, u32)
+{
+    int descriptor = ::open(getSdmcPath(path).c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0644);
+    if (descriptor < 0)
+    {
+        return HOST_ERROR;
+    }
+    bool sized = ::ftruncate(descriptor, size) == 0;
+    ::close(descriptor);
+    return sized ? 0 : HOST_ERROR;
+}
+
+Result fsFsDeleteFile(FsFileSystem *, const char *path)
+{
+    return ::unlink(getSdmcPath(path).c_str()) == 0 ? 0 : HOST_ERROR;
+}
+
+Result fsFsOpenFile(FsFileSystem *, const char *path, u32 mode, FsFile *file)
+{
+    file->fd = ::open(getSdmcPath(path).c_str(), (mode & (FsOpenMode_Write | FsOpenMode_Append) ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    return file->fd >= 0 ? 0 : HOST_ERROR;
+}
+
+Result fsFsGetFreeSpace(FsFileSystem *, const char *path, s64 *out)
+{
+    struct statvfs fileSystemStat;
+    if (::statvfs(getSdmcPath(path).c_str(), &fileSystemStat) != 0)
+    {
+        return HOST_ERROR;
+    }
+    *out = static_cast<s64>(fileSystemStat.f_bavail) * fileSystemStat.f_frsize;
+    return 0;
+}
+
+Result fsFsGetTotalSpace(FsFileSystem *, const char *path, s64 *out)
+{
+    struct statvfs fileSystemStat;
+    if (::statvfs(getSdmcPath(path).c_str(), &fileSystemStat) != 0)
+    {
+        return HOST_ERROR;
+    }
+    *out = static_cast<s64>(fileSystemStat.f_blocks) * fileSystemStat.f_frsize;
+    return 0;
+}
+
+void fsFsClose(FsFileSystem *) {}
+
+Result fsFileRead(FsFile *file, s64 offset, void *buffer, u64 readSize, u32, u64 *bytesRead)
+{
+    ssize_t result = ::pread(file->fd, buffer, readSize, offset);
+    if (result < 0)
+    {
+        return HOST_ERROR;
+    }
+    *bytesRead = static_cast<u64>(result);
+    return 0;
+}
+
+Result fsFileWrite(FsFile *file, s64 offset, const void *buffer, u64 writeSize, u32)
+{
+    const u8 *data = static_cast<const u8 *>(buffer);
+    for (u64 written = 0; written < writeSize;)
+    {
+        ssize_t result = ::pwrite(file->fd, &data[written], writeSize - written, offset + written);
+        if (result <= 0)
+        {
+            return HOST_ERROR;
+        }
+        written += result;
+    }
+    return 0;
+}
+
+Result fsFileSetSize(FsFile *file, s64 size)
+{
+    return ::ftruncate(file->fd, size) == 0 ? 0 : HOST_ERROR;
+}
+
+Result fsFileGetSize(FsFile *file, s64 *out)
+{
+    off_t size = ::lseek(file->fd, 0, SEEK_END);
+    if (size < 0)
+    {
+        return HOST_ERROR;
+    }
+    *out = size;
+    return 0;
+}
+
+Result fsFileFlush(FsFile *)
+{
+    return 0;
+}
+
+void fsFileClose(FsFile *file)
+{
+    ::close(file->fd);
+    file->fd = -1;
+}
+
+void sha256ContextCreate(Sha256Context *context)
+{
+    static constexpr u32 INITIAL_HASH[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+    std::memcpy(context->intermediate_hash, INITIAL_HASH, sizeof(INITIAL_HASH));
+    context->bits_consumed = 0;
+    context->num_buffered = 0;
+}
+
+void sha256ContextUpdate(Sha256Context *context, const void *src, size_t size)
+{
+    const u8 *data = static_cast<const u8 *>(src);
+    context->bits_consumed += size * 8;
+
+    // Top off whatever's buffered first, then go straight from src for every whole block after that.
+    if (context->num_buffered > 0)
+    {
+        size_t copySize = sizeof(context->block) - context->num_buffered;
+        copySize = copySize > size ? size : copySize;
+        std::memcpy(&context->block[context->num_buffered], data, copySize);
+        context->num_buffered += copySize;
+        data += copySize;
+        size -= copySize;
+        if (context->num_buffered < sizeof(context->block))
+        {
+            return;
+        }
+        sha256ProcessBlock(context, context->block);
+        context->num_buffered = 0;
+    }
+
+    for (; size >= sizeof(context->block); data += sizeof(context->block), size -= sizeof(context->block))
+    {
+        sha256ProcessBlock(context, data);
+    }
+    std::memcpy(context->block, data, size);
+    context->num_buffered = size;
+}
+
+void sha256ContextGetHash(Sha256Context *context, void *dst)
+{
+    // A one bit, zeros up to the last eight bytes of a block, and then the length in bits.
+    u64 bitCount = context->bits_consumed;
+    u8 padding[sizeof(context->block) + 8] = {0x80};
+    size_t paddingSize = (context->num_buffered < 56 ? 56 : 120) - context->num_buffered;
+    for (int i = 0; i < 8; i++)
+    {
+        padding[paddingSize + i] = static_cast<u8>(bitCount >> (56 - i * 8));
+    }
+    sha256ContextUpdate(context, padding, paddingSize + 8);
+
+    u8 *hash = static_cast<u8 *>(dst);
+    for (int i = 0; i < 8; i++)
+    {
+        hash[i * 4] = static_cast<u8>(context->intermediate_hash[i] >> 24);
+        hash[i * 4 + 1] = static_cast<u8>(context->intermediate_hash[i] >> 16);
+        hash[i * 4 + 2] = static_cast<u8>(context->intermediate_hash[i] >> 8);
+        hash[i * 4 + 3] = static_cast<u8>(context->intermediate_hash[i]);
+    }
+}
+
+u32 crc32CalculateWithSeed(u32 seed, const void *src, size_t size)
+{
+    // zlib's crc32 is the same CRC libnx computes with the ARMv8 instructions.
+    return static_cast<u32>(crc32(seed, static_cast<const Bytef *>(src), static_cast<uInt>(size)));
+}
+
+Result svcGetInfo(u64 *out, u32 id0, Handle, u64)
+{
+    long pageSize = ::sysconf(_SC_PAGESIZE);
+    if (id0 == InfoType_TotalMemorySize)
+    {
+        *out = static_cast<u64>(::sysconf(_SC_PHYS_PAGES)) * pageSize;
+        return 0;
+    }
+    else if (id0 != InfoType_UsedMemorySize)
+    {
+        return HOST_ERROR;
+    }
+
+    // Second number in statm is the resident set in pages.
+    unsigned long totalPages = 0, residentPages = 0;
+    std::FILE *statm = std::fopen("/proc/self/statm", "r");
+    bool gotPages = statm && std::fscanf(statm, "%lu %lu", &totalPages, &residentPages) == 2;
+    if (statm)
+    {
+        std::fclose(statm);
+    }
+    *out = static_cast<u64>(residentPages) * pageSize;
+    return gotPages ? 0 : HOST_ERROR;
+}
+
+Result svcGetThreadCoreMask(s32 *preferredCore, u64 *affinityMask, Handle)
+{
+    *preferredCore = 0;
+    *affinityMask = 0x7;
+    return 0;
+}
+
+Result svcSetThreadCoreMask(Handle, s32, u32)
+{
+    return 0;
+}
+
+Result svcGetThreadPriority(s32 *priority, Handle)
+{
+    *priority = 0x2C;
+    return 0;
+}
+
+Result svcSetThreadPriority(Handle, u32)
+{
+    return 0;
+}
+
+void svcSleepThread(s64 nano)
+{
+    std::this_thread::sleep_for(std::chrono::nanoseconds(nano));
+}
+
+Handle threadGetCurHandle(void)
+{
+    return 0;
+}
+
+Result setInitialize(void)
+{
+    return 0;
+}
+
+Result setGetSystemLanguage(u64 *languageCode)
+{
+    *languageCode = 0;
+    return 0;
+}
+
+Result setMakeLanguage(u64, SetLanguage *language)
+{
+    *language = SetLanguage_ENUS;
+    return 0;
+}
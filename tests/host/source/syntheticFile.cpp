@@ -0,0 +1,83 @@
+#include "syntheticFile.hpp"
+#include "hostFs.hpp"
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+    // Size of the chunks files are written in.
+    constexpr size_t CHUNK_SIZE = 0x100000;
+} // namespace
+
+// Returns the next number from a xorshift64 generator. NCAs are encrypted, so their contents might as well be noise.
+static uint64_t nextRandom(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+bool syntheticFile::create(const fslib::Path &path, int64_t fileSize, uint64_t seed, uint8_t *hashOut)
+{
+    fslib::File file(path, FsOpenMode_Create | FsOpenMode_Write, fileSize);
+    if (!file.isOpen())
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> chunk(CHUNK_SIZE / sizeof(uint64_t));
+    Sha256Context hashContext;
+    sha256ContextCreate(&hashContext);
+    // xorshift gets stuck on zero.
+    uint64_t state = seed * 0x9E3779B97F4A7C15ULL | 1;
+    for (int64_t offset = 0; offset < fileSize;)
+    {
+        for (uint64_t &word : chunk)
+        {
+            word = nextRandom(state);
+        }
+        size_t writeSize = fileSize - offset < static_cast<int64_t>(CHUNK_SIZE) ? fileSize - offset : CHUNK_SIZE;
+        sha256ContextUpdate(&hashContext, chunk.data(), writeSize);
+        if (file.write(chunk.data(), writeSize) != static_cast<ssize_t>(writeSize))
+        {
+            return false;
+        }
+        offset += writeSize;
+    }
+
+    if (hashOut)
+    {
+        sha256ContextGetHash(&hashContext, hashOut);
+    }
+    return true;
+}
+
+bool syntheticFile::createNca(const fslib::Path &directoryPath, int64_t fileSize, uint64_t seed, fslib::Path *pathOut)
+{
+    fslib::Path temporaryPath = directoryPath / "generating.tmp";
+    uint8_t hash[SHA256_HASH_SIZE] = {0};
+    if (!syntheticFile::create(temporaryPath, fileSize, seed, hash))
+    {
+        return false;
+    }
+
+    char ncaName[0x40] = {0};
+    for (int i = 0; i < 16; i++)
+    {
+        std::snprintf(&ncaName[i * 2], 3, "%02x", hash[i]);
+    }
+    std::snprintf(&ncaName[32], sizeof(ncaName) - 32, ".nca");
+
+    fslib::Path ncaPath = directoryPath / ncaName;
+    if (std::rename(hostFs::getHostPath(temporaryPath.cString()).c_str(), hostFs::getHostPath(ncaPath.cString()).c_str()) != 0)
+    {
+        return false;
+    }
+
+    if (pathOut)
+    {
+        *pathOut = ncaPath;
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+// Checks that runs pushed to MpscQueue come out whole while other threads are pushing too, and that a full queue never waits.
+#include "mpscQueue.hpp"
+#include "testing.hpp"
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Producers pushing at once, how many runs each pushes and how long the runs are.
+    constexpr size_t PRODUCER_COUNT = 3;
+    constexpr size_t RUN_COUNT = 20000;
+    constexpr size_t RUN_LENGTH = 5;
+    constexpr size_t QUEUE_CAPACITY = 16;
+
+    // What's pushed. Each run is one producer's numbered values in order.
+    struct QueueValue
+    {
+            size_t producer = 0;
+            size_t run = 0;
+            size_t index = 0;
+    };
+} // namespace
+
+// Fills the queue from the thread that pops it. Every push past full has to fail right away.
+static void testFullQueue(void)
+{
+    MpscQueue<int, QUEUE_CAPACITY> queue{};
+    int values[QUEUE_CAPACITY] = {0};
+    TEST_CHECK(queue.tryPushAll(values, QUEUE_CAPACITY - 2));
+    TEST_CHECK(!queue.tryPushAll(values, 3));
+    TEST_CHECK(queue.tryPush(1) && queue.tryPush(2) && !queue.tryPush(3));
+
+    int value = 0;
+    TEST_CHECK(queue.tryPop(value) && queue.tryPop(value));
+    TEST_CHECK(queue.tryPushAll(values, 2) && !queue.tryPush(3));
+}
+
+// Every producer pushes runs as fast as it can while this thread pops. Every run has to come out whole and in order.
+static void testContiguousRuns(void)
+{
+    MpscQueue<QueueValue, QUEUE_CAPACITY> queue{};
+    std::vector<std::thread> producers;
+    for (size_t producer = 0; producer < PRODUCER_COUNT; producer++)
+    {
+        producers.emplace_back([&queue, producer]() {
+            for (size_t run = 0; run < RUN_COUNT;)
+            {
+                QueueValue values[RUN_LENGTH];
+                for (size_t i = 0; i < RUN_LENGTH; i++)
+                {
+                    values[i] = {.producer = producer, .run = run, .index = i};
+                }
+                // A full queue has to be emptied by the consumer, so give it the core.
+                if (!queue.tryPushAll(values, RUN_LENGTH))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                ++run;
+            }
+        });
+    }
+
+    size_t splitRunCount = 0;
+    size_t nextRuns[PRODUCER_COUNT] = {0};
+    QueueValue previous{};
+    for (size_t popCount = 0; popCount < PRODUCER_COUNT * RUN_COUNT * RUN_LENGTH;)
+    {
+        QueueValue value{};
+        if (!queue.tryPop(value))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Anything but the start of a run has to follow the value before it in the same run.
+        bool isRunStart = value.index == 0 && value.run == nextRuns[value.producer];
+        bool followsPrevious = value.producer == previous.producer && value.run == previous.run && value.index == previous.index + 1;
+        splitRunCount += !isRunStart && !followsPrevious;
+        nextRuns[value.producer] += value.index == RUN_LENGTH - 1;
+        previous = value;
+        ++popCount;
+    }
+
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    TEST_CHECK(splitRunCount == 0);
+}
+
+int main(void)
+{
+    if (!testing::begin("mpscQueue"))
+    {
+        return 1;
+    }
+
+    testFullQueue();
+    testContiguousRuns();
+
+    return testing::end();
+}
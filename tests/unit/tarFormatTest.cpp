@@ -0,0 +1,211 @@
+// Checks tars from TarWriter and the tar dump block by block, then reads them back with libarchive and extracts them with GNU tar.
+#include "manifest.hpp"
+#include "syntheticFile.hpp"
+#include "tar.hpp"
+#include "tarWriter.hpp"
+#include "testing.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Everything in a tar is in blocks of this.
+    constexpr int64_t BLOCK_SIZE = 512;
+    // Sizes around the block size, including the ones that land right on it.
+    constexpr int64_t ENTRY_SIZES[] = {0, 1, 511, 512, 513, 0x1000, 0x12345};
+    // Name lengths around where ustar runs out and where the pax record's length gains a digit. Every path component is kept short
+    // enough for the host's filesystem.
+    constexpr size_t NAME_LENGTHS[] = {99, 100, 101, 150, 988, 990, 992, 994};
+    constexpr size_t NAME_COMPONENT_LENGTH = 60;
+} // namespace
+
+// Returns a path that's length characters long under directory, broken into NAME_COMPONENT_LENGTH character components.
+static std::string getLongName(const std::string &directory, size_t length)
+{
+    std::string name = directory;
+    while (name.length() < length)
+    {
+        bool isLastComponent = length - name.length() <= NAME_COMPONENT_LENGTH + 1;
+        name += '/';
+        name.append(isLastComponent ? length - name.length() : NAME_COMPONENT_LENGTH, 'a' + name.length() % 26);
+    }
+    return name;
+}
+
+// Makes every directory leading up to name under sys:/.
+static bool createParents(const std::string &name)
+{
+    bool created = true;
+    for (size_t slash = name.find('/'); created && slash != name.npos; slash = name.find('/', slash + 1))
+    {
+        created = fslib::createDirectory(fslib::Path("sys:/") / name.substr(0, slash));
+    }
+    return created;
+}
+
+// Walks every header in the tar at path and checks its checksum and that everything lands on a block. Returns the number of file entries
+// or -1 if anything's wrong.
+static int countValidEntries(const fslib::Path &path)
+{
+    fslib::File tarFile(path, FsOpenMode_Read);
+    std::vector<unsigned char> tarData(tarFile.getSize());
+    if (!tarFile.isOpen() || tarFile.read(tarData.data(), tarData.size()) != static_cast<ssize_t>(tarData.size()) ||
+        tarData.size() % BLOCK_SIZE != 0)
+    {
+        return -1;
+    }
+
+    int entryCount = 0;
+    size_t offset = 0;
+    for (; offset + BLOCK_SIZE <= tarData.size() && tarData[offset] != 0; entryCount++)
+    {
+        const unsigned char *header = &tarData[offset];
+        unsigned int checksum = 0;
+        for (int64_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            // The checksum field itself counts as spaces.
+            checksum += i >= 148 && i < 156 ? ' ' : header[i];
+        }
+
+        char *fieldEnd = nullptr;
+        unsigned long storedChecksum = std::strtoul(reinterpret_cast<const char *>(&header[148]), &fieldEnd, 8);
+        int64_t entrySize = std::strtoll(reinterpret_cast<const char *>(&header[124]), &fieldEnd, 8);
+        if (storedChecksum != checksum || std::memcmp(&header[257], "ustar", 6) != 0)
+        {
+            return -1;
+        }
+        // pax headers aren't entries of their own.
+        entryCount -= header[156] == 'x' || header[156] == '5';
+        offset += BLOCK_SIZE + (entrySize + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    }
+
+    // Exactly two zero blocks and nothing after.
+    bool endIsValid = offset + BLOCK_SIZE * 2 == tarData.size();
+    for (size_t i = offset; endIsValid && i < tarData.size(); i++)
+    {
+        endIsValid = tarData[i] == 0;
+    }
+    return endIsValid ? entryCount : -1;
+}
+
+// Extracts the tar at tarPath with GNU tar and checks every file in manifest came out the same as it went in under sys:/Contents.
+static bool extractsWithGnuTar(const fslib::Path &tarPath, const std::vector<std::string> &names)
+{
+    fslib::deleteDirectoryRecursively("sdmc:/extracted");
+    if (!fslib::createDirectory("sdmc:/extracted") ||
+        !testing::runCommand("tar -xf \"" + testing::getHostPath(tarPath) + "\" -C \"" + testing::getHostPath("sdmc:/extracted") + "\""))
+    {
+        return false;
+    }
+
+    bool allMatch = true;
+    for (const std::string &name : names)
+    {
+        allMatch = allMatch && testing::filesMatch(fslib::Path("sys:/") / name, fslib::Path("sdmc:/extracted") / name);
+    }
+    return allMatch;
+}
+
+// Writes files of every interesting size and name length through TarWriter with exactly the reservation it asks for.
+static void testTarWriter(void)
+{
+    std::vector<std::string> names;
+    for (int64_t entrySize : ENTRY_SIZES)
+    {
+        names.push_back("writer/size" + std::to_string(entrySize));
+        TEST_CHECK(createParents(names.back()) && syntheticFile::create(fslib::Path("sys:/") / names.back(), entrySize, entrySize + 1));
+    }
+    for (size_t nameLength : NAME_LENGTHS)
+    {
+        names.push_back(getLongName("writer/long" + std::to_string(nameLength), nameLength));
+        TEST_CHECK(names.back().length() == nameLength);
+        TEST_CHECK(createParents(names.back()) && syntheticFile::create(fslib::Path("sys:/") / names.back(), nameLength, nameLength));
+    }
+
+    int64_t reserveSize = TarWriter::getEndRecordSize() + TarWriter::getDirectorySize("writer");
+    for (const std::string &name : names)
+    {
+        fslib::File file(fslib::Path("sys:/") / name, FsOpenMode_Read);
+        reserveSize += TarWriter::getEntrySize(name.c_str(), file.getSize());
+    }
+
+    TarWriter writer{};
+    TEST_CHECK(writer.open("sdmc:/writer.tar", reserveSize));
+    TEST_CHECK(writer.addDirectory("writer"));
+    for (const std::string &name : names)
+    {
+        fslib::File file(fslib::Path("sys:/") / name, FsOpenMode_Read);
+        std::vector<unsigned char> data(file.getSize());
+        TEST_CHECK(file.read(data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+        TEST_CHECK(writer.beginEntry(name.c_str(), data.size()));
+        TEST_CHECK(writer.write(data.data(), data.size()));
+        TEST_CHECK(writer.endEntry());
+    }
+    // Writing past what the header said has to be refused.
+    TEST_CHECK(writer.beginEntry("writer/overrun", 1));
+    TEST_CHECK(!writer.write("ab", 2));
+    TEST_CHECK(writer.endEntry());
+    TEST_CHECK(writer.close());
+
+    fslib::File tarFile("sdmc:/writer.tar", FsOpenMode_Read);
+    TEST_CHECK(tarFile.getSize() == reserveSize + TarWriter::getEntrySize("writer/overrun", 1));
+    TEST_CHECK(countValidEntries("sdmc:/writer.tar") == static_cast<int>(names.size()) + 1);
+
+    // The overrun entry comes out as a single zero, so it's made to match before the tar is read back.
+    fslib::File overrunFile("sys:/writer/overrun", FsOpenMode_Create | FsOpenMode_Write);
+    TEST_CHECK(overrunFile.write("", 1) == 1);
+    overrunFile.close();
+    names.push_back("writer/overrun");
+
+    size_t fileCount = 0;
+    TEST_CHECK(testing::archiveMatches("sdmc:/writer.tar", "sys:/", fileCount) && fileCount == names.size());
+    TEST_CHECK(extractsWithGnuTar("sdmc:/writer.tar", names));
+}
+
+// Dumps a generated tree to a tar and reads it back every way there is.
+static void testTarDump(void)
+{
+    bool created = fslib::createDirectory("sys:/Contents") && fslib::createDirectory("sys:/Contents/registered") &&
+                   fslib::createDirectory("sys:/Contents/placehld");
+    for (uint64_t i = 0; i < 30 && created; i++)
+    {
+        std::string directoryName = "sys:/Contents/registered/" + std::to_string(i % 4);
+        int64_t fileSize = i % 10 == 1 ? 0x280000 + i * 0x1001 : 0x200 * (i % 3) + i * 0x31;
+        created = fslib::createDirectory(directoryName) && syntheticFile::createNca(directoryName, fileSize, i + 1);
+    }
+
+    Manifest manifest{};
+    TEST_CHECK(created && manifest.scan("sys:/Contents"));
+    copyManifestToTar(manifest, "sys:/Contents", "sdmc:/FirmwareDump.tar");
+
+    std::vector<std::string> names;
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        if (!entry.isDirectory)
+        {
+            names.push_back("Contents/" + entry.path);
+        }
+    }
+
+    size_t fileCount = 0;
+    TEST_CHECK(countValidEntries("sdmc:/FirmwareDump.tar") == static_cast<int>(manifest.getFileCount()));
+    TEST_CHECK(testing::archiveMatches("sdmc:/FirmwareDump.tar", "sys:/", fileCount) && fileCount == manifest.getFileCount());
+    TEST_CHECK(extractsWithGnuTar("sdmc:/FirmwareDump.tar", names));
+    // The empty placeholder directory has to come out too.
+    TEST_CHECK(fslib::directoryExists("sdmc:/extracted/Contents/placehld"));
+}
+
+int main(void)
+{
+    if (!testing::begin("tarFormat"))
+    {
+        return 1;
+    }
+
+    testTarWriter();
+    testTarDump();
+
+    return testing::end();
+}
@@ -0,0 +1,192 @@
+#include "testing.hpp"
+#include "bufferPool.hpp"
+#include "console.hpp"
+#include "hostFs.hpp"
+#include "logger.hpp"
+#include "strings.hpp"
+#include <archive.h>
+#include <archive_entry.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+namespace
+{
+    // Where every test's directories go. The Makefile runs tests from tests/.
+    const char *TEST_DATA_PATH = "build/testData";
+    // Size of the chunks filesMatch compares.
+    constexpr size_t COMPARE_CHUNK_SIZE = 0x100000;
+
+    const char *s_testName = "";
+    std::atomic<int> s_failureCount = 0;
+    // Stands in for the UI thread so Console's queue keeps getting emptied.
+    std::atomic<bool> s_consoleIsRunning = false;
+    std::thread s_consoleThread;
+} // namespace
+
+// Empties and maps device to TEST_DATA_PATH/testName/device.
+static bool mapScratchDevice(const char *device)
+{
+    char *dataPath = ::realpath(TEST_DATA_PATH, nullptr);
+    if (!dataPath)
+    {
+        return false;
+    }
+    std::string devicePath = std::string(dataPath) + "/" + s_testName + "/" + device;
+    std::free(dataPath);
+
+    hostFs::mapDevice("test", devicePath);
+    fslib::deleteDirectoryRecursively("test:/");
+    hostFs::mapDevice(device, devicePath);
+    return fslib::createDirectory(std::string(device) + ":/");
+}
+
+bool testing::begin(const char *testName)
+{
+    s_testName = testName;
+    if (!fslib::createDirectory("build") || !fslib::createDirectory(TEST_DATA_PATH) ||
+        !fslib::createDirectory(std::string(TEST_DATA_PATH) + "/" + testName) || !mapScratchDevice("sys") || !mapScratchDevice("sdmc") ||
+        !fslib::createDirectory("sdmc:/switch"))
+    {
+        std::fprintf(stderr, "%s: error creating test directories: %s\n", testName, fslib::getErrorString());
+        return false;
+    }
+
+    logger::initialize();
+    strings::initialize();
+    if (!bufferPool::initialize())
+    {
+        std::fprintf(stderr, "%s: error allocating buffer pool.\n", testName);
+        return false;
+    }
+
+    s_consoleIsRunning = true;
+    s_consoleThread = std::thread([]() {
+        while (s_consoleIsRunning)
+        {
+            Console::render();
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+        Console::render();
+    });
+    return true;
+}
+
+int testing::end(void)
+{
+    s_consoleIsRunning = false;
+    if (s_consoleThread.joinable())
+    {
+        s_consoleThread.join();
+    }
+    bufferPool::exit();
+    logger::exit();
+
+    int failureCount = s_failureCount;
+    std::printf("%s: %s\n", s_testName, failureCount == 0 ? "passed" : "FAILED");
+    return failureCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void testing::check(bool condition, const char *expression, const char *file, int line)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++s_failureCount;
+    }
+}
+
+std::string testing::getHostPath(const fslib::Path &path)
+{
+    return hostFs::getHostPath(path.cString());
+}
+
+bool testing::filesMatch(const fslib::Path &pathA, const fslib::Path &pathB)
+{
+    fslib::File fileA(pathA, FsOpenMode_Read);
+    fslib::File fileB(pathB, FsOpenMode_Read);
+    if (!fileA.isOpen() || !fileB.isOpen() || fileA.getSize() != fileB.getSize())
+    {
+        return false;
+    }
+
+    std::unique_ptr<unsigned char[]> bufferA = std::make_unique<unsigned char[]>(COMPARE_CHUNK_SIZE);
+    std::unique_ptr<unsigned char[]> bufferB = std::make_unique<unsigned char[]>(COMPARE_CHUNK_SIZE);
+    for (int64_t offset = 0; offset < fileA.getSize();)
+    {
+        ssize_t readSizeA = fileA.read(bufferA.get(), COMPARE_CHUNK_SIZE);
+        ssize_t readSizeB = fileB.read(bufferB.get(), COMPARE_CHUNK_SIZE);
+        if (readSizeA <= 0 || readSizeA != readSizeB || std::memcmp(bufferA.get(), bufferB.get(), readSizeA) != 0)
+        {
+            return false;
+        }
+        offset += readSizeA;
+    }
+    return true;
+}
+
+bool testing::archiveMatches(const fslib::Path &archivePath, const fslib::Path &root, size_t &fileCountOut)
+{
+    fileCountOut = 0;
+    struct archive *reader = archive_read_new();
+    archive_read_support_format_all(reader);
+    if (archive_read_open_filename(reader, testing::getHostPath(archivePath).c_str(), COMPARE_CHUNK_SIZE) != ARCHIVE_OK)
+    {
+        std::fprintf(stderr, "libarchive can't open %s: %s\n", archivePath.cString(), archive_error_string(reader));
+        archive_read_free(reader);
+        return false;
+    }
+
+    bool matches = true;
+    std::unique_ptr<unsigned char[]> archiveBuffer = std::make_unique<unsigned char[]>(COMPARE_CHUNK_SIZE);
+    std::unique_ptr<unsigned char[]> fileBuffer = std::make_unique<unsigned char[]>(COMPARE_CHUNK_SIZE);
+    struct archive_entry *entry = nullptr;
+    int result = ARCHIVE_OK;
+    while (matches && (result = archive_read_next_header(reader, &entry)) == ARCHIVE_OK)
+    {
+        fslib::Path entryPath = root / archive_entry_pathname(entry);
+        if (archive_entry_filetype(entry) == AE_IFDIR)
+        {
+            matches = fslib::directoryExists(entryPath);
+            continue;
+        }
+
+        ++fileCountOut;
+        fslib::File file(entryPath, FsOpenMode_Read);
+        int64_t totalRead = 0;
+        for (la_ssize_t readSize = 0; matches && (readSize = archive_read_data(reader, archiveBuffer.get(), COMPARE_CHUNK_SIZE)) != 0;)
+        {
+            matches = readSize > 0 && file.isOpen() && file.read(fileBuffer.get(), readSize) == readSize &&
+                      std::memcmp(archiveBuffer.get(), fileBuffer.get(), readSize) == 0;
+            totalRead += readSize > 0 ? readSize : 0;
+        }
+        matches = matches && totalRead == file.getSize();
+        if (!matches)
+        {
+            std::fprintf(stderr, "%s doesn't match %s: %s\n", archive_entry_pathname(entry), entryPath.cString(), archive_error_string(reader));
+        }
+    }
+
+    if (matches && result != ARCHIVE_EOF)
+    {
+        std::fprintf(stderr, "libarchive can't read %s: %s\n", archivePath.cString(), archive_error_string(reader));
+        matches = false;
+    }
+    archive_read_free(reader);
+    return matches;
+}
+
+bool testing::runCommand(const std::string &command)
+{
+    int status = std::system(command.c_str());
+    if (status != 0)
+    {
+        std::fprintf(stderr, "\"%s\" failed with %d.\n", command.c_str(), status);
+    }
+    return status == 0;
+}
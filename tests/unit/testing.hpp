@@ -0,0 +1,31 @@
+#pragma once
+#include "fslib.hpp"
+#include <cstdint>
+#include <string>
+
+// Checks condition and records a failure with where it was if it's false. Tests keep going after a failure so one run shows all of them.
+#define TEST_CHECK(condition) testing::check((condition), #condition, __FILE__, __LINE__)
+
+// What every test program shares. Each test gets empty sys:/ and sdmc:/ directories of its own under build/testData and everything the
+// engines expect to be running on the Switch.
+namespace testing
+{
+    // Maps sys:/ and sdmc:/ to fresh directories for testName and starts the logger, strings, buffer pool and a thread that keeps the
+    // console drained. Returns false if any of that failed.
+    bool begin(const char *testName);
+    // Stops what begin() started and prints how the test went. Returns what main should.
+    int end(void);
+
+    // Use TEST_CHECK instead.
+    void check(bool condition, const char *expression, const char *file, int line);
+
+    // Returns where path is on the host. For handing to zlib, libarchive and the like.
+    std::string getHostPath(const fslib::Path &path);
+    // Returns whether the files at pathA and pathB exist and have the same bytes.
+    bool filesMatch(const fslib::Path &pathA, const fslib::Path &pathB);
+    // Reads the archive at archivePath with libarchive and checks every file in it against the file with the same path under root.
+    // Directories just have to exist there. fileCountOut gets how many files were in it. Returns false and says why if anything's off.
+    bool archiveMatches(const fslib::Path &archivePath, const fslib::Path &root, size_t &fileCountOut);
+    // Runs command with the shell and returns whether it exited with zero.
+    bool runCommand(const std::string &command);
+} // namespace testing
@@ -0,0 +1,216 @@
+// Checks that verifying passes good dumps and catches damaged ones, whether the damage is in a folder dump, a stored ZIP or a deflated one.
+#include "io.hpp"
+#include "manifest.hpp"
+#include "manifestFile.hpp"
+#include "syntheticFile.hpp"
+#include "testing.hpp"
+#include "verify.hpp"
+#include "zip.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace
+{
+    // Thread counts everything's verified with.
+    constexpr size_t VERIFY_THREAD_COUNTS[] = {1, 4};
+    // Size of the ZIP's local file header before the name and extra field.
+    constexpr int64_t LOCAL_HEADER_SIZE = 30;
+} // namespace
+
+// Makes a tree of NCAs with a few other files mixed in. ncaCountOut gets how many of them are NCAs.
+static bool createTree(size_t &ncaCountOut)
+{
+    ncaCountOut = 0;
+    bool created = fslib::createDirectory("sys:/Contents") && fslib::createDirectory("sys:/Contents/registered");
+    for (uint64_t i = 0; i < 24 && created; i++)
+    {
+        std::string directoryName = "sys:/Contents/registered/" + std::to_string(i % 3);
+        int64_t fileSize = i % 8 == 1 ? 0x240000 + i * 0x1001 : 0x400 + i * 0x53;
+        created = fslib::createDirectory(directoryName);
+        if (i % 5 == 0)
+        {
+            created = created && syntheticFile::create(fslib::Path(directoryName) / ("other" + std::to_string(i)), fileSize, i + 1);
+            continue;
+        }
+        created = created && syntheticFile::createNca(directoryName, fileSize, i + 1);
+        ++ncaCountOut;
+    }
+    return created;
+}
+
+// Flips one bit at offset in the file at path. fslib can't seek, so this goes straight to the host file.
+static bool damageFile(const fslib::Path &path, int64_t offset)
+{
+    std::fstream file(testing::getHostPath(path), std::ios::in | std::ios::out | std::ios::binary);
+    char byte = 0;
+    if (!file.seekg(offset).get(byte))
+    {
+        return false;
+    }
+    byte ^= 0x10;
+    return static_cast<bool>(file.seekp(offset).put(byte).flush());
+}
+
+// Verifies jobs on every thread count and checks the results. The jobs are reordered by verifyJobs, so each run gets its own copy.
+static void checkJobs(const std::vector<VerifyJob> &jobs, size_t expectedFailedCount)
+{
+    for (size_t threadCount : VERIFY_THREAD_COUNTS)
+    {
+        std::vector<VerifyJob> jobsCopy = jobs;
+        VerifyResult result{};
+        verifyJobs(jobsCopy, threadCount, result);
+        TEST_CHECK(result.checkedCount == jobs.size());
+        TEST_CHECK(result.failedCount == expectedFailedCount);
+    }
+}
+
+// Jobs that start in the middle of a file and carry their own CRCs, the way ZIP entries do.
+static void testJobs(void)
+{
+    std::vector<unsigned char> data(0x30000);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = static_cast<unsigned char>(i * 7 + i / 251);
+    }
+    fslib::File file("sdmc:/jobs.bin", FsOpenMode_Create | FsOpenMode_Write);
+    TEST_CHECK(file.write(data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+    file.close();
+
+    std::vector<VerifyJob> jobs;
+    const int64_t offsets[] = {0, 0x1001, 0x20000};
+    for (int64_t offset : offsets)
+    {
+        VerifyJob job{};
+        job.name = "jobs" + std::to_string(offset);
+        job.path = "sdmc:/jobs.bin";
+        job.offset = offset;
+        job.size = 0x8000;
+        job.hasCrc = true;
+        job.crc = crc32(0, data.data() + offset, job.size);
+        jobs.push_back(job);
+    }
+    checkJobs(jobs, 0);
+
+    // A wrong CRC, a job that runs off the end of the file and one for a file that isn't there.
+    jobs[0].crc ^= 1;
+    jobs[1].offset = data.size() - 0x10;
+    jobs[2].path = "sdmc:/missing.bin";
+    checkJobs(jobs, 3);
+}
+
+// Verifies the folder dump on every thread count against the manifest at manifestPath and checks the results.
+static void checkFolder(const fslib::Path &manifestPath, size_t checkedCount, size_t failedCount, size_t ncaCount, size_t ncaMismatchCount)
+{
+    for (size_t threadCount : VERIFY_THREAD_COUNTS)
+    {
+        VerifyResult result{};
+        TEST_CHECK(verifyFolder("sdmc:/FirmwareDump", manifestPath, threadCount, result));
+        TEST_CHECK(result.checkedCount == checkedCount && result.failedCount == failedCount);
+        TEST_CHECK(result.ncaCount == ncaCount && result.ncaMismatchCount == ncaMismatchCount);
+    }
+}
+
+// Returns the first file in manifest whose path does or doesn't contain ".nca".
+static const ManifestEntry *findFile(const Manifest &manifest, bool isNca)
+{
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        if (!entry.isDirectory && (entry.path.find(".nca") != entry.path.npos) == isNca)
+        {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Dumps the tree to a folder and verifies it, then damages it a piece at a time. Every piece has to be caught with the manifest, only the
+// NCAs without it.
+static void testFolder(const Manifest &manifest, size_t ncaCount)
+{
+    fslib::Path destination = "sdmc:/FirmwareDump";
+    TEST_CHECK(fslib::createDirectory(destination));
+    {
+        ManifestFile manifestFile{};
+        TEST_CHECK(manifestFile.create("sdmc:/FirmwareDump.manifest", destination));
+        copyManifest(manifest, "sys:/Contents", destination, 2, &manifestFile);
+    }
+    size_t fileCount = manifest.getFileCount();
+    checkFolder("sdmc:/FirmwareDump.manifest", fileCount, 0, ncaCount, 0);
+
+    // An NCA that doesn't match its name.
+    const ManifestEntry *damagedNca = findFile(manifest, true);
+    TEST_CHECK(damagedNca && damageFile(destination / damagedNca->path, damagedNca->size / 2));
+    checkFolder("sdmc:/FirmwareDump.manifest", fileCount, 1, ncaCount, 1);
+
+    // Something that only the manifest can catch.
+    const ManifestEntry *damagedFile = findFile(manifest, false);
+    TEST_CHECK(damagedFile && damageFile(destination / damagedFile->path, damagedFile->size - 1));
+    checkFolder("sdmc:/FirmwareDump.manifest", fileCount, 2, ncaCount, 1);
+
+    // A file the manifest has that's gone, and one it doesn't have at all.
+    const ManifestEntry *deletedNca = nullptr;
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        if (!deletedNca && &entry != damagedNca && !entry.isDirectory && entry.path.find(".nca") != entry.path.npos)
+        {
+            deletedNca = &entry;
+        }
+    }
+    TEST_CHECK(deletedNca && fslib::deleteFile(destination / deletedNca->path));
+    TEST_CHECK(syntheticFile::create(destination / "stray", 0x1234, 99));
+    checkFolder("sdmc:/FirmwareDump.manifest", fileCount + 1, 4, ncaCount - 1, 1);
+
+    // Without the manifest, the damaged NCA is all there is to find.
+    checkFolder("sdmc:/missing.manifest", fileCount, 1, ncaCount - 1, 1);
+}
+
+// Dumps the tree to a ZIP at compressionLevel, verifies it, then damages the first entry's data and checks it's caught.
+static void testZip(const Manifest &manifest, int compressionLevel)
+{
+    const char *zipPath = "sdmc:/FirmwareDump.zip";
+    copyManifestToZip(manifest, "sys:/Contents", zipPath, compressionLevel);
+
+    for (size_t threadCount : VERIFY_THREAD_COUNTS)
+    {
+        VerifyResult result{};
+        TEST_CHECK(verifyZip(zipPath, threadCount, result));
+        TEST_CHECK(result.checkedCount == manifest.getFileCount() && result.failedCount == 0);
+    }
+
+    // The first entry's data starts right after its local header, name and extra field.
+    unsigned char localHeader[LOCAL_HEADER_SIZE] = {0};
+    fslib::File zipFile(zipPath, FsOpenMode_Read);
+    TEST_CHECK(zipFile.read(localHeader, LOCAL_HEADER_SIZE) == LOCAL_HEADER_SIZE);
+    zipFile.close();
+    int64_t dataOffset = LOCAL_HEADER_SIZE + (localHeader[26] | localHeader[27] << 8) + (localHeader[28] | localHeader[29] << 8);
+    TEST_CHECK(damageFile(zipPath, dataOffset + 0x10));
+
+    for (size_t threadCount : VERIFY_THREAD_COUNTS)
+    {
+        VerifyResult result{};
+        TEST_CHECK(verifyZip(zipPath, threadCount, result));
+        TEST_CHECK(result.checkedCount == manifest.getFileCount() && result.failedCount == 1);
+    }
+    fslib::deleteFile(zipPath);
+}
+
+int main(void)
+{
+    if (!testing::begin("verifier"))
+    {
+        return 1;
+    }
+
+    testJobs();
+
+    size_t ncaCount = 0;
+    Manifest manifest{};
+    TEST_CHECK(createTree(ncaCount) && manifest.scan("sys:/Contents"));
+    testFolder(manifest, ncaCount);
+    testZip(manifest, Z_NO_COMPRESSION);
+    testZip(manifest, Z_DEFAULT_COMPRESSION);
+
+    return testing::end();
+}
@@ -0,0 +1,148 @@
+// Checks that work stealing hands every task out exactly once and that the folder copy gets every file across whole no matter how many
+// pipelines it's split across.
+#include "io.hpp"
+#include "manifest.hpp"
+#include "manifestFile.hpp"
+#include "syntheticFile.hpp"
+#include "testing.hpp"
+#include "workStealingDeque.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Tasks pushed for the concurrent steal test and how many threads go after them.
+    constexpr int STEAL_TASK_COUNT = 100000;
+    constexpr size_t THIEF_COUNT = 3;
+    // Pipeline counts the folder copy is run with.
+    constexpr size_t PIPELINE_COUNTS[] = {1, 2, 3, 4};
+} // namespace
+
+// The owner works off the back, thieves off the front.
+static void testDequeEnds(void)
+{
+    WorkStealingDeque<int> deque{};
+    for (int i = 0; i < 4; i++)
+    {
+        deque.push(i);
+    }
+
+    int value = -1;
+    TEST_CHECK(deque.pop(value) && value == 3);
+    TEST_CHECK(deque.steal(value) && value == 0);
+    TEST_CHECK(deque.pop(value) && value == 2);
+    TEST_CHECK(deque.steal(value) && value == 1);
+    TEST_CHECK(!deque.pop(value) && !deque.steal(value));
+}
+
+// The owner and every thief go at the same deque at once. Every task has to come out exactly once.
+static void testConcurrentSteal(void)
+{
+    WorkStealingDeque<int> deque{};
+    for (int i = 0; i < STEAL_TASK_COUNT; i++)
+    {
+        deque.push(i);
+    }
+
+    std::unique_ptr<std::atomic<int>[]> takenCounts = std::make_unique<std::atomic<int>[]>(STEAL_TASK_COUNT);
+    std::vector<std::thread> thieves;
+    for (size_t i = 0; i < THIEF_COUNT; i++)
+    {
+        thieves.emplace_back([&]() {
+            for (int value = 0; deque.steal(value);)
+            {
+                ++takenCounts[value];
+            }
+        });
+    }
+    for (int value = 0; deque.pop(value);)
+    {
+        ++takenCounts[value];
+    }
+    for (std::thread &thief : thieves)
+    {
+        thief.join();
+    }
+
+    int wrongCount = 0;
+    for (int i = 0; i < STEAL_TASK_COUNT; i++)
+    {
+        wrongCount += takenCounts[i] != 1;
+    }
+    TEST_CHECK(wrongCount == 0);
+}
+
+// Makes a tree with empty files, tiny ones, a few big ones and some nesting. Returns false if it couldn't.
+static bool createTree(void)
+{
+    bool created = fslib::createDirectory("sys:/Contents") && fslib::createDirectory("sys:/Contents/registered") &&
+                   fslib::createDirectory("sys:/Contents/placehld") && fslib::createDirectory("sys:/Contents/registered/empty");
+    for (uint64_t i = 0; i < 96 && created; i++)
+    {
+        std::string directoryName = "sys:/Contents/registered/" + std::to_string(i % 8);
+        created = fslib::createDirectory(directoryName);
+
+        // Every fourth is empty, a few are bigger than a slot, everything else is CNMT sized. Empty NCAs would all have the same name.
+        int64_t fileSize = i % 16 == 1 ? 0x300000 + i * 0x1001 : 0x200 + i * 0x61;
+        created = created && (i % 4 == 0 ? syntheticFile::create(fslib::Path(directoryName) / ("empty" + std::to_string(i)), 0, i + 1)
+                                         : syntheticFile::createNca(directoryName, fileSize, i + 1));
+    }
+    return created;
+}
+
+// Copies the tree with pipelineCount pipelines and checks every file made it across whole and was recorded.
+static void testCopy(const Manifest &manifest, size_t pipelineCount)
+{
+    fslib::Path destination = "sdmc:/FirmwareDump";
+    fslib::deleteDirectoryRecursively(destination);
+    fslib::createDirectory(destination);
+
+    {
+        ManifestFile manifestFile{};
+        TEST_CHECK(manifestFile.create("sdmc:/FirmwareDump.manifest", destination));
+        copyManifest(manifest, "sys:/Contents", destination, pipelineCount, &manifestFile);
+    }
+
+    ManifestFile writtenManifest{};
+    TEST_CHECK(writtenManifest.load("sdmc:/FirmwareDump.manifest"));
+    TEST_CHECK(writtenManifest.getCount() == manifest.getFileCount());
+
+    size_t mismatchCount = 0;
+    for (const ManifestEntry &entry : manifest.getEntries())
+    {
+        fslib::Path copyPath = destination / entry.path;
+        if (entry.isDirectory)
+        {
+            mismatchCount += !fslib::directoryExists(copyPath);
+            continue;
+        }
+
+        const ManifestFileEntry *record = writtenManifest.find(entry.path);
+        mismatchCount += !testing::filesMatch(fslib::Path("sys:/Contents") / entry.path, copyPath) || !record || record->size != entry.size;
+    }
+    TEST_CHECK(mismatchCount == 0);
+}
+
+int main(void)
+{
+    if (!testing::begin("workDistribution"))
+    {
+        return 1;
+    }
+
+    testDequeEnds();
+    testConcurrentSteal();
+
+    Manifest manifest{};
+    TEST_CHECK(createTree() && manifest.scan("sys:/Contents"));
+    TEST_CHECK(manifest.getFileCount() == 96);
+    for (size_t pipelineCount : PIPELINE_COUNTS)
+    {
+        testCopy(manifest, pipelineCount);
+    }
+
+    return testing::end();
+}
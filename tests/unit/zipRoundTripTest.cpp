@@ -0,0 +1,273 @@
+// Round trips data through ParallelDeflate and zlib's inflate, and ZIPs written by ZipWriter and the ZIP dumps through libarchive. Every
+// ZIP biggestDump writes uses the ZIP64 records, so small ones are enough to check them.
+#include "manifest.hpp"
+#include "parallelDeflate.hpp"
+#include "syntheticFile.hpp"
+#include "testing.hpp"
+#include "zip.hpp"
+#include "zipWriter.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace
+{
+    // Thread counts ParallelDeflate is run with. Zero is what it falls back to when none of its workers can start.
+    constexpr size_t DEFLATE_THREAD_COUNTS[] = {0, 1, 3};
+    // Sizes that land on, around, and well past ParallelDeflate's block size.
+    constexpr size_t DEFLATE_SIZES[] = {0, 1, 0x7FFF, 0x20000, 0x20001, 0xA0123};
+    // How many pieces each input is passed to compress() in. The dictionary has to carry across calls.
+    constexpr size_t DEFLATE_CALL_COUNTS[] = {1, 3};
+} // namespace
+
+// Returns size bytes that deflate well but aren't all the same.
+static std::vector<unsigned char> getCompressibleData(size_t size)
+{
+    std::vector<unsigned char> data(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        data[i] = static_cast<unsigned char>("biggestDump "[i % 12] + (i / 4099) % 3);
+    }
+    return data;
+}
+
+// Inflates the raw deflate stream in compressed. Returns false if zlib doesn't think it's one complete stream.
+static bool inflateRaw(const std::vector<unsigned char> &compressed, std::vector<unsigned char> &dataOut)
+{
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+    {
+        return false;
+    }
+
+    unsigned char outputBuffer[0x4000];
+    stream.next_in = const_cast<Bytef *>(compressed.data());
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    int result = Z_OK;
+    while (result == Z_OK)
+    {
+        stream.next_out = outputBuffer;
+        stream.avail_out = sizeof(outputBuffer);
+        result = inflate(&stream, Z_NO_FLUSH);
+        dataOut.insert(dataOut.end(), outputBuffer, outputBuffer + (sizeof(outputBuffer) - stream.avail_out));
+    }
+    inflateEnd(&stream);
+    return result == Z_STREAM_END && stream.avail_in == 0;
+}
+
+// Compresses data in callCount pieces and checks it inflates back to the same thing with the same CRC and sizes. Each piece is passed
+// from a scratch buffer that's wiped as soon as compress() returns, the way the engine hands its slots back.
+static void testDeflate(ParallelDeflate &deflate, const std::vector<unsigned char> &data, size_t callCount)
+{
+    std::vector<unsigned char> compressed;
+    ParallelDeflate::OutputFunction output = [&compressed](const unsigned char *output, size_t outputSize) {
+        compressed.insert(compressed.end(), output, output + outputSize);
+        return true;
+    };
+
+    deflate.begin(output);
+    size_t pieceSize = data.size() / callCount;
+    for (size_t i = 0, offset = 0; i < callCount; i++, offset += pieceSize)
+    {
+        bool isLast = i + 1 == callCount;
+        std::vector<unsigned char> piece(data.begin() + offset, isLast ? data.end() : data.begin() + offset + pieceSize);
+        TEST_CHECK(deflate.compress(piece.data(), piece.size(), isLast));
+        std::memset(piece.data(), 0xAA, piece.size());
+    }
+
+    std::vector<unsigned char> inflated;
+    TEST_CHECK(inflateRaw(compressed, inflated));
+    TEST_CHECK(inflated == data);
+    TEST_CHECK(deflate.getCrc() == crc32(0, data.data(), static_cast<uInt>(data.size())));
+    TEST_CHECK(deflate.getUncompressedSize() == data.size());
+    TEST_CHECK(deflate.getCompressedSize() == compressed.size());
+}
+
+static void testParallelDeflate(void)
+{
+    for (size_t threadCount : DEFLATE_THREAD_COUNTS)
+    {
+        ParallelDeflate deflate(Z_DEFAULT_COMPRESSION, threadCount);
+        for (size_t size : DEFLATE_SIZES)
+        {
+            std::vector<unsigned char> noise(size);
+            for (size_t i = 0; i < size; i++)
+            {
+                noise[i] = static_cast<unsigned char>((i * 0x9E3779B1u) >> 13);
+            }
+
+            for (size_t callCount : DEFLATE_CALL_COUNTS)
+            {
+                testDeflate(deflate, getCompressibleData(size), callCount);
+                testDeflate(deflate, noise, callCount);
+            }
+        }
+    }
+}
+
+// Adds name from sys:/ to writer as a stored entry.
+static void writeStoredEntry(ZipWriter &writer, const char *name)
+{
+    fslib::File storedFile(fslib::Path("sys:/") / name, FsOpenMode_Read);
+    std::vector<unsigned char> storedData(storedFile.getSize());
+    TEST_CHECK(storedFile.read(storedData.data(), storedData.size()) == static_cast<ssize_t>(storedData.size()));
+    TEST_CHECK(writer.beginEntry(name, false));
+    TEST_CHECK(writer.write(storedData.data(), storedData.size()));
+    TEST_CHECK(writer.endEntry(crc32(0, storedData.data(), static_cast<uInt>(storedData.size())), storedData.size()));
+}
+
+// Deflates name from sys:/ with zlib and adds it to writer.
+static void writeDeflatedEntry(ZipWriter &writer, const char *name)
+{
+    fslib::File sourceFile(fslib::Path("sys:/") / name, FsOpenMode_Read);
+    std::vector<unsigned char> data(sourceFile.getSize());
+    TEST_CHECK(sourceFile.read(data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+
+    std::vector<unsigned char> compressed(compressBound(data.size()));
+    z_stream stream{};
+    TEST_CHECK(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    stream.next_in = data.data();
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = compressed.data();
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    TEST_CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    TEST_CHECK(writer.beginEntry(name, true));
+    TEST_CHECK(writer.write(compressed.data(), compressed.size()));
+    TEST_CHECK(writer.endEntry(crc32(0, data.data(), static_cast<uInt>(data.size())), data.size()));
+}
+
+// Writes entries straight through ZipWriter. A ZIP of only stored entries has to come out exactly the size the writer said it would.
+static void testZipWriter(void)
+{
+    const char *storedNames[] = {"writer/empty", "writer/small", "writer/big"};
+    const size_t storedSizes[] = {0, 0x1234, 0x312345};
+    const char *deflatedName = "writer/deflated";
+
+    TEST_CHECK(fslib::createDirectory("sys:/writer"));
+    int64_t reserveSize = ZipWriter::getEndRecordSize();
+    for (size_t i = 0; i < 3; i++)
+    {
+        TEST_CHECK(syntheticFile::create(fslib::Path("sys:/") / storedNames[i], storedSizes[i], i + 1));
+        reserveSize += ZipWriter::getStoredEntrySize(storedNames[i], storedSizes[i]);
+    }
+    std::vector<unsigned char> deflatedData = getCompressibleData(0x54321);
+    fslib::File deflatedFile(fslib::Path("sys:/") / deflatedName, FsOpenMode_Create | FsOpenMode_Write);
+    TEST_CHECK(deflatedFile.write(deflatedData.data(), deflatedData.size()) == static_cast<ssize_t>(deflatedData.size()));
+    deflatedFile.close();
+
+    {
+        ZipWriter writer{};
+        TEST_CHECK(writer.open("sdmc:/stored.zip", reserveSize));
+        for (const char *name : storedNames)
+        {
+            writeStoredEntry(writer, name);
+        }
+        TEST_CHECK(writer.close());
+    }
+    size_t fileCount = 0;
+    fslib::File storedZip("sdmc:/stored.zip", FsOpenMode_Read);
+    TEST_CHECK(storedZip.getSize() == reserveSize);
+    TEST_CHECK(testing::archiveMatches("sdmc:/stored.zip", "sys:/", fileCount) && fileCount == 3);
+
+    {
+        ZipWriter writer{};
+        TEST_CHECK(writer.open("sdmc:/mixed.zip", reserveSize));
+        writeDeflatedEntry(writer, deflatedName);
+        for (const char *name : storedNames)
+        {
+            writeStoredEntry(writer, name);
+        }
+        TEST_CHECK(writer.close());
+    }
+    TEST_CHECK(testing::archiveMatches("sdmc:/mixed.zip", "sys:/", fileCount) && fileCount == 4);
+}
+
+// Makes a tree for the dump to ZIP. A third of it is compressible so the deflated dump isn't just stored noise.
+static bool createTree(void)
+{
+    bool created = fslib::createDirectory("sys:/Contents") && fslib::createDirectory("sys:/Contents/registered");
+    for (uint64_t i = 0; i < 40 && created; i++)
+    {
+        std::string directoryName = "sys:/Contents/registered/" + std::to_string(i % 5);
+        created = fslib::createDirectory(directoryName);
+
+        int64_t fileSize = i % 10 == 1 ? 0x280000 + i * 0x1001 : 0x300 + i * 0x97;
+        if (i % 3 == 0)
+        {
+            std::vector<unsigned char> data = getCompressibleData(fileSize);
+            fslib::File file(fslib::Path(directoryName) / ("data" + std::to_string(i)), FsOpenMode_Create | FsOpenMode_Write);
+            created = created && file.write(data.data(), data.size()) == static_cast<ssize_t>(data.size());
+        }
+        else
+        {
+            created = created && syntheticFile::createNca(directoryName, fileSize, i + 1);
+        }
+    }
+    return created;
+}
+
+// Dumps the tree to a ZIP at compressionLevel and reads it back.
+static void testZipDump(const Manifest &manifest, int compressionLevel)
+{
+    copyManifestToZip(manifest, "sys:/Contents", "sdmc:/FirmwareDump.zip", compressionLevel);
+
+    size_t fileCount = 0;
+    TEST_CHECK(testing::archiveMatches("sdmc:/FirmwareDump.zip", "sys:/", fileCount));
+    TEST_CHECK(fileCount == manifest.getFileCount());
+}
+
+// Splits the tree across volumes. Volume sizes too small for the end records or the largest file have to be refused before anything's
+// written. Anything bigger has to come out as volumes that together hold every file.
+static void testSplitZip(const Manifest &manifest)
+{
+    const int64_t tooSmallSizes[] = {0, ZipWriter::getEndRecordSize(), ZipWriter::getEndRecordSize() + 0x100000};
+    for (int64_t volumeSize : tooSmallSizes)
+    {
+        copyManifestToSplitZip(manifest, "sys:/Contents", "sdmc:/TooSmall", volumeSize, 2);
+        TEST_CHECK(!fslib::fileExists("sdmc:/TooSmall.part01.zip"));
+    }
+
+    copyManifestToSplitZip(manifest, "sys:/Contents", "sdmc:/FirmwareDump", 0x800000, 2);
+    size_t totalFileCount = 0;
+    char volumePath[FS_MAX_PATH];
+    for (unsigned int i = 1;; i++)
+    {
+        std::snprintf(volumePath, FS_MAX_PATH, "sdmc:/FirmwareDump.part%02u.zip", i);
+        if (!fslib::fileExists(volumePath))
+        {
+            break;
+        }
+
+        fslib::File volumeFile(volumePath, FsOpenMode_Read);
+        TEST_CHECK(volumeFile.getSize() <= 0x800000);
+
+        size_t fileCount = 0;
+        TEST_CHECK(testing::archiveMatches(volumePath, "sys:/", fileCount));
+        totalFileCount += fileCount;
+    }
+    TEST_CHECK(totalFileCount == manifest.getFileCount());
+}
+
+int main(void)
+{
+    if (!testing::begin("zipRoundTrip"))
+    {
+        return 1;
+    }
+
+    testParallelDeflate();
+    testZipWriter();
+
+    Manifest manifest{};
+    TEST_CHECK(createTree() && manifest.scan("sys:/Contents"));
+    testZipDump(manifest, Z_NO_COMPRESSION);
+    testZipDump(manifest, Z_DEFAULT_COMPRESSION);
+    testSplitZip(manifest);
+
+    return testing::end();
+}
@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+# Turns the language files in romfs into tables biggestDump can index straight into. This runs as part of the build, so there's no JSON
+# to parse and nothing to replace at startup anymore.
+#
+# Usage: generateStrings.py <language folder> <output folder>
+# Writes stringNames.hpp with the enums and stringTable.hpp with the strings themselves.
+import json
+import os
+import re
+import sys
+
+# Every language is checked against this one. Anything missing from the others falls back to it.
+BASE_LANGUAGE = "ENUS"
+
+# Same as what strings::initialize used to do at runtime. Order matters the same way it did there.
+BUTTON_GLYPHS = [
+    ("[A]", "\ue0e0"),
+    ("[B]", "\ue0e1"),
+    ("[X]", "\ue0e2"),
+    ("[Y]", "\ue0e3"),
+    ("[L]", "\ue0e4"),
+    ("[R]", "\ue0e5"),
+    ("[ZL]", "\ue0e6"),
+    ("[ZR]", "\ue0e7"),
+    ("[SL]", "\ue0e8"),
+    ("[SR]", "\ue0e9"),
+    ("[DPAD]", "\ue0ea"),
+    ("[DUP]", "\ue0eb"),
+    ("[DDOWN]", "\ue0ec"),
+    ("[DLEFT]", "\ue0ed"),
+    ("[DRIGHT]", "\ue0ee"),
+    ("[+]", "\ue0ef"),
+    ("[-]", "\ue0f0"),
+]
+
+HEADER_COMMENT = "// Generated by tools/generateStrings.py from romfs/*.json. Edit those and rebuild instead of this.\n"
+
+
+def get_enum_name(key):
+    """CopyingFileZip -> COPYING_FILE_ZIP, TuningIO -> TUNING_IO."""
+    name = re.sub(r"([a-z0-9])([A-Z])", r"\1_\2", key)
+    name = re.sub(r"([A-Z]+)([A-Z][a-z])", r"\1_\2", name)
+    return name.upper()
+
+
+def replace_buttons(string):
+    for button, glyph in BUTTON_GLYPHS:
+        string = string.replace(button, glyph)
+    return string
+
+
+def to_c_string(string):
+    """Anything that isn't plain ASCII is written as octal so the compiler's charset can't get in the way."""
+    literal = ""
+    for byte in string.encode("utf-8"):
+        if byte == ord("\n"):
+            literal += "\\n"
+        elif byte == ord('"') or byte == ord("\\"):
+            literal += "\\" + chr(byte)
+        elif 0x20 <= byte < 0x7F:
+            literal += chr(byte)
+        else:
+            literal += "\\%03o" % byte
+    return '"' + literal + '"'
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("Usage: generateStrings.py <language folder> <output folder>")
+    language_folder, output_folder = sys.argv[1], sys.argv[2]
+
+    languages = {}
+    for file_name in sorted(os.listdir(language_folder)):
+        if file_name.endswith(".json"):
+            with open(os.path.join(language_folder, file_name), encoding="utf-8") as language_file:
+                languages[file_name[:-5]] = json.load(language_file)
+
+    if BASE_LANGUAGE not in languages:
+        sys.exit("generateStrings.py: %s.json is missing from %s." % (BASE_LANGUAGE, language_folder))
+
+    keys = list(languages[BASE_LANGUAGE].keys())
+    for language, strings in languages.items():
+        for key in keys:
+            if key not in strings:
+                print("generateStrings.py: %s is missing %s. Using %s's." % (language, key, BASE_LANGUAGE), file=sys.stderr)
+        for key in strings:
+            if key not in keys:
+                print("generateStrings.py: %s has %s, but %s doesn't. Skipping it." % (language, key, BASE_LANGUAGE), file=sys.stderr)
+
+    names = "#pragma once\n" + HEADER_COMMENT + "\n"
+    names += "namespace strings\n{\n"
+    names += "    // Names of every string. Index into the table with these.\n"
+    names += "    namespace names\n    {\n        enum Name\n        {\n"
+    for key in keys:
+        names += "            %s,\n" % get_enum_name(key)
+    names += "            NAME_COUNT\n        };\n    } // namespace names\n\n"
+    names += "    // Every language there's a file for.\n"
+    names += "    enum Language\n    {\n"
+    for language in languages:
+        names += "        LANGUAGE_%s,\n" % language
+    names += "        LANGUAGE_COUNT\n    };\n"
+    names += "} // namespace strings\n"
+
+    table = "#pragma once\n" + HEADER_COMMENT + '#include "stringNames.hpp"\n\n'
+    table += "namespace strings\n{\n"
+    table += "    // Every string in every language with the button glyphs already in place.\n"
+    table += "    static constexpr const char *STRING_TABLE[LANGUAGE_COUNT][names::NAME_COUNT] = {\n"
+    for language, strings in languages.items():
+        table += "        // %s\n        {\n" % language
+        for key in keys:
+            string = strings.get(key, languages[BASE_LANGUAGE][key])
+            table += "            %s,\n" % to_c_string(replace_buttons(string))
+        table += "        },\n"
+    table += "    };\n"
+    table += "} // namespace strings\n"
+
+    os.makedirs(output_folder, exist_ok=True)
+    # Only touch what changed so make doesn't rebuild everything that includes strings.hpp for nothing.
+    for file_name, contents in (("stringNames.hpp", names), ("stringTable.hpp", table)):
+        path = os.path.join(output_folder, file_name)
+        if os.path.exists(path):
+            with open(path, encoding="utf-8") as existing_file:
+                if existing_file.read() == contents:
+                    continue
+        with open(path, "w", encoding="utf-8") as output_file:
+            output_file.write(contents)
+
+
+if __name__ == "__main__":
+    main()